@@ -0,0 +1,55 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace pcd
+{
+    /// \class AlignedAllocator
+    ///
+    /// \brief Standard allocator returning storage aligned to \p Alignment bytes,
+    /// so that columns start on a cache line and vector loads never split one.
+    template <typename T, std::size_t Alignment = 64>
+    class AlignedAllocator
+    {
+    public:
+        typedef T value_type;
+
+        template <typename U>
+        struct rebind
+        {
+            typedef AlignedAllocator<U, Alignment> other;
+        };
+
+        AlignedAllocator() noexcept {}
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+        T *allocate(std::size_t n)
+        {
+            return static_cast<T *>(
+                ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        void deallocate(T *ptr, std::size_t) noexcept
+        {
+            ::operator delete(ptr, std::align_val_t(Alignment));
+        }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept
+        {
+            return true;
+        }
+        template <typename U>
+        bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept
+        {
+            return false;
+        }
+    };
+} // namespace pcd
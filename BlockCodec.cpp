@@ -0,0 +1,183 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "BlockCodec.h"
+
+#include <algorithm>
+#include <climits>
+#include <mutex>
+#include <string.h>
+
+#include "LZ4.h"
+#include "LZF.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        namespace
+        {
+            class LZFCodec : public BlockCodec
+            {
+            public:
+                const char *Name() const override { return "lzf"; }
+                size_t CompressBound(size_t in_len) const override
+                {
+                    return in_len + in_len / 16 + 64;
+                }
+                size_t Compress(const char *in_data, size_t in_len,
+                                char *out_data, size_t out_len, int level) const override
+                {
+                    if (in_len > UINT_MAX)
+                    {
+                        return 0;
+                    }
+                    return lzfCompress(in_data, (unsigned int)in_len, out_data,
+                                       (unsigned int)std::min<size_t>(out_len, UINT_MAX), level);
+                }
+                bool Decompress(const char *in_data, size_t in_len,
+                                char *out_data, size_t out_len) const override
+                {
+                    return in_len <= UINT_MAX && out_len <= UINT_MAX &&
+                           lzfDecompress(in_data, (unsigned int)in_len, out_data,
+                                         (unsigned int)out_len) == out_len;
+                }
+            };
+
+            class LZ4Codec : public BlockCodec
+            {
+            public:
+                const char *Name() const override { return "lz4"; }
+                size_t CompressBound(size_t in_len) const override
+                {
+                    return in_len + in_len / 255 + 16;
+                }
+                size_t Compress(const char *in_data, size_t in_len,
+                                char *out_data, size_t out_len, int level) const override
+                {
+                    if (in_len > UINT_MAX)
+                    {
+                        return 0;
+                    }
+                    return lz4Compress(in_data, (unsigned int)in_len, out_data,
+                                       (unsigned int)std::min<size_t>(out_len, UINT_MAX), level);
+                }
+                bool Decompress(const char *in_data, size_t in_len,
+                                char *out_data, size_t out_len) const override
+                {
+                    return in_len <= UINT_MAX && out_len <= UINT_MAX &&
+                           lz4Decompress(in_data, (unsigned int)in_len, out_data,
+                                         (unsigned int)out_len) == out_len;
+                }
+            };
+
+            /// Stores blocks as they are, for data that does not compress or
+            /// when write speed matters more than size.
+            class StoreCodec : public BlockCodec
+            {
+            public:
+                const char *Name() const override { return "store"; }
+                size_t CompressBound(size_t in_len) const override { return in_len; }
+                size_t Compress(const char *in_data, size_t in_len,
+                                char *out_data, size_t out_len, int) const override
+                {
+                    if (out_len < in_len)
+                    {
+                        return 0;
+                    }
+                    memcpy(out_data, in_data, in_len);
+                    return in_len;
+                }
+                bool Decompress(const char *in_data, size_t in_len,
+                                char *out_data, size_t out_len) const override
+                {
+                    if (in_len != out_len)
+                    {
+                        return false;
+                    }
+                    memcpy(out_data, in_data, in_len);
+                    return true;
+                }
+            };
+
+            struct CodecRegistry
+            {
+                std::mutex mutex;
+                // never shrinks, so handed out pointers stay valid
+                std::vector<std::unique_ptr<BlockCodec>> codecs;
+            };
+
+            CodecRegistry &GlobalRegistry()
+            {
+                // Leaked so that codecs outlive the destructors of other statics.
+                static CodecRegistry *registry = []
+                {
+                    auto *registry = new CodecRegistry;
+                    registry->codecs.emplace_back(new LZFCodec);
+                    registry->codecs.emplace_back(new LZ4Codec);
+                    registry->codecs.emplace_back(new StoreCodec);
+                    return registry;
+                }();
+                return *registry;
+            }
+        } // unnamed namespace
+
+        bool RegisterBlockCodec(std::unique_ptr<BlockCodec> codec)
+        {
+            if (codec == nullptr)
+            {
+                return false;
+            }
+            std::string name = codec->Name() != NULL ? codec->Name() : "";
+            if (name.empty() || name.find_first_of(" \t\r\n") != std::string::npos)
+            {
+                return false;
+            }
+            CodecRegistry &registry = GlobalRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (const auto &registered : registry.codecs)
+            {
+                if (name == registered->Name())
+                {
+                    return false;
+                }
+            }
+            registry.codecs.push_back(std::move(codec));
+            return true;
+        }
+
+        const BlockCodec *FindBlockCodec(const std::string &name)
+        {
+            CodecRegistry &registry = GlobalRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (const auto &codec : registry.codecs)
+            {
+                if (name == codec->Name())
+                {
+                    return codec.get();
+                }
+            }
+            return NULL;
+        }
+
+        std::vector<std::string> BlockCodecNames()
+        {
+            CodecRegistry &registry = GlobalRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            std::vector<std::string> names;
+            for (const auto &codec : registry.codecs)
+            {
+                names.push_back(codec->Name());
+            }
+            return names;
+        }
+
+        const BlockCodec &LZFBlockCodec()
+        {
+            static const BlockCodec *codec = FindBlockCodec("lzf");
+            return *codec;
+        }
+    } // namespace io
+} // namespace pcd
@@ -0,0 +1,86 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Geometry.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        /// Compression levels of BlockCodec::Compress, the values of
+        /// WritePointCloudOption::CompressionLevel.
+        enum : int
+        {
+            /// Small hash table and fast skipping over incompressible data.
+            CODEC_LEVEL_FAST = 1,
+            CODEC_LEVEL_DEFAULT = 2,
+            /// Large hash table and more thorough match search, for the
+            /// smallest output.
+            CODEC_LEVEL_BEST = 3
+        };
+
+        /// \class BlockCodec
+        ///
+        /// \brief Compressor of the independent blocks of binary_compressed data.
+        ///
+        /// Codecs are looked up by name in a process-wide registry. The name of
+        /// the codec that wrote a file is recorded in its header, so readers pick
+        /// the same one. Built in are "lzf", the format PCL reads and the
+        /// default, which is never recorded; "lz4", an LZ4 block codec that
+        /// compresses and decompresses several times faster than LZF at a
+        /// somewhat lower ratio; and "store", which copies the data. Files
+        /// written with another codec than "lzf" are only readable by this
+        /// library.
+        ///
+        /// Blocks are compressed on several threads at once, so implementations
+        /// must be safe to call concurrently.
+        class PCDIO_EXPORTS BlockCodec
+        {
+        public:
+            virtual ~BlockCodec() {}
+
+        public:
+            /// Name recorded in the header, a single token without spaces.
+            virtual const char *Name() const = 0;
+            /// Largest compressed size of \p in_len bytes.
+            virtual size_t CompressBound(size_t in_len) const = 0;
+            /// \brief Compresses \p in_len bytes at \p in_data into at most
+            /// \p out_len bytes at \p out_data.
+            ///
+            /// Returns the compressed size, or 0 on failure.
+            ///
+            /// \param level One of the CODEC_LEVEL_* values. Codecs without levels
+            /// ignore it.
+            virtual size_t Compress(const char *in_data, size_t in_len,
+                                    char *out_data, size_t out_len, int level) const = 0;
+            /// Decompresses \p in_len bytes at \p in_data into exactly \p out_len
+            /// bytes at \p out_data. Returns `false` if the data is corrupt.
+            virtual bool Decompress(const char *in_data, size_t in_len,
+                                    char *out_data, size_t out_len) const = 0;
+        };
+
+        /// \brief Adds \p codec to the registry.
+        ///
+        /// Returns `false` if its name is empty, contains spaces or is already
+        /// taken, in which case \p codec is dropped.
+        PCDIO_EXPORTS bool RegisterBlockCodec(std::unique_ptr<BlockCodec> codec);
+
+        /// Returns the codec registered as \p name, or NULL.
+        PCDIO_EXPORTS const BlockCodec *FindBlockCodec(const std::string &name);
+
+        /// Lists the names of the registered codecs.
+        PCDIO_EXPORTS std::vector<std::string> BlockCodecNames();
+
+        /// The LZF codec of PCL's binary_compressed data.
+        PCDIO_EXPORTS const BlockCodec &LZFBlockCodec();
+    } // namespace io
+} // namespace pcd
@@ -0,0 +1,399 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "FileBatchReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string.h>
+
+#include "Logging.h"
+#include "MappedFile.h"
+
+#if !defined _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// io_uring is driven through its raw system calls, so no liburing is needed.
+// OPENAT, STATX and CLOSE arrived in Linux 5.6 together with RW_CUR_POS.
+#if defined(__linux__) && !defined(PCDIO_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_FEAT_RW_CUR_POS)
+#define PCDIO_HAVE_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+// Largest single read request, reads of bigger files are split.
+#define PCD_BATCH_READ_BYTES (1u << 30)
+
+namespace pcd
+{
+    namespace io
+    {
+        bool ReadWholeFile(const std::string &filename, std::vector<char> &buffer)
+        {
+#if !defined _WIN32
+            int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+            {
+                buffer.resize((size_t)st.st_size);
+                size_t done = 0;
+                while (done < buffer.size())
+                {
+                    ssize_t got = pread(fd, buffer.data() + done, buffer.size() - done, (off_t)done);
+                    if (got < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (got <= 0)
+                    {
+                        break;
+                    }
+                    done += (size_t)got;
+                }
+                close(fd);
+                // a file truncated while reading keeps what could be read
+                buffer.resize(done);
+                return true;
+            }
+            close(fd);
+#endif
+            // Pipes and special files have no size to read up to.
+            MappedFile file;
+            if (!file.Open(filename))
+            {
+                return false;
+            }
+            buffer.assign(file.Data(), file.Data() + file.Size());
+            return true;
+        }
+
+#if defined(PCDIO_HAVE_IO_URING)
+        /// Submission and completion queues of one io_uring instance.
+        struct FileBatchReader::Ring
+        {
+            int fd = -1;
+            void *sq_ring = MAP_FAILED;
+            void *cq_ring = MAP_FAILED;
+            size_t sq_ring_size = 0;
+            size_t cq_ring_size = 0;
+            io_uring_sqe *sqes = (io_uring_sqe *)MAP_FAILED;
+            size_t sqes_size = 0;
+            unsigned *sq_tail = NULL;
+            unsigned *sq_mask = NULL;
+            unsigned *sq_array = NULL;
+            unsigned *cq_head = NULL;
+            unsigned *cq_tail = NULL;
+            unsigned *cq_mask = NULL;
+            io_uring_cqe *cqes = NULL;
+            // tail of the submission queue, published to the kernel on Drain()
+            unsigned sq_next = 0;
+            // prepared but not yet submitted
+            unsigned queued = 0;
+            // submitted but not yet completed
+            unsigned inflight = 0;
+
+            ~Ring()
+            {
+                if (sqes != MAP_FAILED)
+                {
+                    munmap(sqes, sqes_size);
+                }
+                if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+                {
+                    munmap(cq_ring, cq_ring_size);
+                }
+                if (sq_ring != MAP_FAILED)
+                {
+                    munmap(sq_ring, sq_ring_size);
+                }
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+
+            bool Init(unsigned entries)
+            {
+                io_uring_params params;
+                memset(&params, 0, sizeof(params));
+                fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+                if (fd < 0 || (params.features & IORING_FEAT_RW_CUR_POS) == 0)
+                {
+                    return false;
+                }
+                sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single_mmap)
+                {
+                    sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+                }
+                sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+                if (sq_ring == MAP_FAILED)
+                {
+                    return false;
+                }
+                cq_ring = single_mmap ? sq_ring
+                                      : mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (cq_ring == MAP_FAILED)
+                {
+                    return false;
+                }
+                sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                sqes = (io_uring_sqe *)mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+                if (sqes == MAP_FAILED)
+                {
+                    return false;
+                }
+                char *sq = (char *)sq_ring;
+                char *cq = (char *)cq_ring;
+                sq_tail = (unsigned *)(sq + params.sq_off.tail);
+                sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+                sq_array = (unsigned *)(sq + params.sq_off.array);
+                cq_head = (unsigned *)(cq + params.cq_off.head);
+                cq_tail = (unsigned *)(cq + params.cq_off.tail);
+                cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+                cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+                sq_next = *sq_tail;
+                return true;
+            }
+
+            /// Appends a cleared entry to the submission queue.
+            io_uring_sqe *Prepare(uint8_t opcode, uint64_t user_data)
+            {
+                unsigned index = sq_next++ & *sq_mask;
+                io_uring_sqe *sqe = &sqes[index];
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = opcode;
+                sqe->user_data = user_data;
+                sq_array[index] = index;
+                queued++;
+                return sqe;
+            }
+
+            /// Submits the queued entries and passes every completion to
+            /// \p complete, which may queue more entries, until none is left.
+            template <typename Complete>
+            bool Drain(Complete complete)
+            {
+                while (queued > 0 || inflight > 0)
+                {
+                    __atomic_store_n(sq_tail, sq_next, __ATOMIC_RELEASE);
+                    int submitted = (int)syscall(__NR_io_uring_enter, fd, queued, 1,
+                                                 IORING_ENTER_GETEVENTS, NULL, 0);
+                    if (submitted < 0)
+                    {
+                        if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                        {
+                            continue;
+                        }
+                        return false;
+                    }
+                    queued -= (unsigned)submitted;
+                    inflight += (unsigned)submitted;
+                    unsigned head = *cq_head;
+                    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                    for (; head != tail; head++)
+                    {
+                        const io_uring_cqe &cqe = cqes[head & *cq_mask];
+                        inflight--;
+                        complete(cqe.user_data, cqe.res);
+                    }
+                    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+                }
+                return true;
+            }
+        };
+
+        namespace
+        {
+            // Operation of a completion, stored in the low bits of its user data.
+            enum BatchOp : uint64_t
+            {
+                kOpen = 0,
+                kStat = 1,
+                kRead = 2,
+                kClose = 3
+            };
+
+            uint64_t BatchUserData(size_t file, BatchOp op) { return (uint64_t)file << 2 | op; }
+        } // unnamed namespace
+#else
+        struct FileBatchReader::Ring
+        {
+        };
+#endif
+
+        FileBatchReader::FileBatchReader(size_t max_files) : max_files_(std::max<size_t>(max_files, 1))
+        {
+#if defined(PCDIO_HAVE_IO_URING)
+            ring_.reset(new Ring);
+            // every file has an open and a size query in flight at once
+            if (!ring_->Init((unsigned)max_files_ * 2))
+            {
+                ring_.reset();
+            }
+#endif
+        }
+
+        FileBatchReader::~FileBatchReader() = default;
+
+        bool FileBatchReader::IsAsync() const { return ring_ != nullptr; }
+
+        void FileBatchReader::Read(const std::string *filenames, size_t count,
+                                   std::vector<char> *buffers, bool *ok)
+        {
+            // files that fall back to ReadWholeFile()
+            std::vector<char> fallback(count, 1);
+#if defined(PCDIO_HAVE_IO_URING)
+            std::vector<int> fds(count, -1);
+            std::vector<struct statx> stats(count);
+            std::vector<char> stat_ok(count, 0);
+            std::vector<size_t> done(count, 0);
+            for (size_t begin = 0; ring_ != nullptr && begin < count; begin += max_files_)
+            {
+                size_t end = std::min(count, begin + max_files_);
+                Ring &ring = *ring_;
+                for (size_t i = begin; i < end; i++)
+                {
+                    io_uring_sqe *sqe = ring.Prepare(IORING_OP_OPENAT, BatchUserData(i, kOpen));
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = (uint64_t)(uintptr_t)filenames[i].c_str();
+                    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                    sqe = ring.Prepare(IORING_OP_STATX, BatchUserData(i, kStat));
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = (uint64_t)(uintptr_t)filenames[i].c_str();
+                    sqe->len = STATX_TYPE | STATX_SIZE;
+                    sqe->off = (uint64_t)(uintptr_t)&stats[i];
+                }
+                bool drained = ring.Drain([&](uint64_t user_data, int res) {
+                    size_t i = (size_t)(user_data >> 2);
+                    if ((user_data & 3) == kOpen)
+                    {
+                        fds[i] = res;
+                    }
+                    else
+                    {
+                        stat_ok[i] = res == 0;
+                    }
+                });
+
+                auto queue_read = [&](size_t i) {
+                    io_uring_sqe *sqe = ring.Prepare(IORING_OP_READ, BatchUserData(i, kRead));
+                    sqe->fd = fds[i];
+                    sqe->addr = (uint64_t)(uintptr_t)(buffers[i].data() + done[i]);
+                    sqe->len = (uint32_t)std::min<size_t>(buffers[i].size() - done[i],
+                                                          PCD_BATCH_READ_BYTES);
+                    sqe->off = done[i];
+                };
+                auto queue_close = [&](size_t i) {
+                    io_uring_sqe *sqe = ring.Prepare(IORING_OP_CLOSE, BatchUserData(i, kClose));
+                    sqe->fd = fds[i];
+                };
+                for (size_t i = begin; drained && i < end; i++)
+                {
+                    if (fds[i] < 0)
+                    {
+                        // the kernel does not know the operation, try the slow way
+                        fallback[i] = fds[i] == -EINVAL || fds[i] == -EOPNOTSUPP;
+                        ok[i] = false;
+                        continue;
+                    }
+                    if (!stat_ok[i] || !S_ISREG(stats[i].stx_mode))
+                    {
+                        queue_close(i);
+                        continue;
+                    }
+                    fallback[i] = 0;
+                    ok[i] = true;
+                    buffers[i].resize((size_t)stats[i].stx_size);
+                    if (buffers[i].empty())
+                    {
+                        queue_close(i);
+                    }
+                    else
+                    {
+                        queue_read(i);
+                    }
+                }
+                drained = drained && ring.Drain([&](uint64_t user_data, int res) {
+                    size_t i = (size_t)(user_data >> 2);
+                    if ((user_data & 3) == kClose)
+                    {
+                        // The descriptor is released even if close fails, so
+                        // closing it again could hit a file opened since.
+                        if (res < 0)
+                        {
+                            utility::LogWarning("[FileBatchReader] Failed to close %s: %s\n",
+                                                filenames[i].c_str(), strerror(-res));
+                        }
+                        fds[i] = -1;
+                        return;
+                    }
+                    if (res == -EINTR || res == -EAGAIN)
+                    {
+                        queue_read(i);
+                        return;
+                    }
+                    if (res < 0)
+                    {
+                        ok[i] = false;
+                        queue_close(i);
+                        return;
+                    }
+                    done[i] += (size_t)res;
+                    if (res > 0 && done[i] < buffers[i].size())
+                    {
+                        queue_read(i);
+                        return;
+                    }
+                    // a file truncated while reading keeps what could be read
+                    buffers[i].resize(done[i]);
+                    queue_close(i);
+                });
+                if (!drained)
+                {
+                    // The ring is unusable; requests still queued in it are
+                    // dropped with it and the rest of the batch is read slowly.
+                    // Files it opened and did not close yet are closed here.
+                    ring_.reset();
+                    for (size_t i = begin; i < count; i++)
+                    {
+                        if (fds[i] >= 0)
+                        {
+                            close(fds[i]);
+                            fds[i] = -1;
+                        }
+                        fallback[i] = 1;
+                    }
+                }
+            }
+#endif
+            for (size_t i = 0; i < count; i++)
+            {
+                if (fallback[i])
+                {
+                    ok[i] = ReadWholeFile(filenames[i], buffers[i]);
+                }
+            }
+        }
+    } // namespace io
+} // namespace pcd
@@ -0,0 +1,59 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Geometry.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        /// \brief Reads the whole of \p filename into \p buffer with `pread`,
+        /// reusing the capacity of \p buffer.
+        PCDIO_EXPORTS bool ReadWholeFile(const std::string &filename, std::vector<char> &buffer);
+
+        /// \class FileBatchReader
+        ///
+        /// \brief Reads many whole files with few system calls.
+        ///
+        /// On Linux the opens, size queries, reads and closes of a batch are
+        /// submitted through one io_uring, so a batch of N files costs a handful
+        /// of `io_uring_enter` calls instead of 4N syscalls. Where io_uring is
+        /// not available (other platforms, old kernels, sandboxes that forbid
+        /// it) IsAsync() is `false` and callers should use ReadWholeFile()
+        /// from several threads instead.
+        class PCDIO_EXPORTS FileBatchReader
+        {
+        public:
+            /// \param max_files Largest batch passed to Read().
+            explicit FileBatchReader(size_t max_files);
+            ~FileBatchReader();
+            FileBatchReader(const FileBatchReader &) = delete;
+            FileBatchReader &operator=(const FileBatchReader &) = delete;
+
+        public:
+            /// Returns `true` if batches are read through io_uring.
+            bool IsAsync() const;
+
+            /// \brief Reads \p count files into \p buffers.
+            ///
+            /// \p ok[i] is set to whether \p filenames[i] could be read. Files the
+            /// ring cannot handle, such as pipes, are read with ReadWholeFile().
+            void Read(const std::string *filenames, size_t count,
+                      std::vector<char> *buffers, bool *ok);
+
+        private:
+            struct Ring;
+            std::unique_ptr<Ring> ring_;
+            size_t max_files_;
+        };
+    } // namespace io
+} // namespace pcd
@@ -8,14 +8,18 @@
 
 #include <string>
 
-#if defined _WIN32 || defined WINCE || defined __MINGW32__
+// PCDAPI_EXPORTS is defined while building the library, PCDIO_STATIC by
+// users of the static library.
+#if defined PCDIO_STATIC
+#define PCDIO_EXPORTS
+#elif defined _WIN32 || defined WINCE || defined __MINGW32__
 #ifdef PCDAPI_EXPORTS
 #define PCDIO_EXPORTS __declspec(dllexport)
 #else
-#define PCDIO_EXPORTS
+#define PCDIO_EXPORTS __declspec(dllimport)
 #endif
 #else
-#define PCDIO_EXPORTS
+#define PCDIO_EXPORTS __attribute__((visibility("default")))
 #endif
 
 namespace pcd
@@ -60,6 +64,8 @@ namespace pcd
                 OrientedBoundingBox = 11,
                 /// AxisAlignedBoundingBox
                 AxisAlignedBoundingBox = 12,
+                /// PointCloudSoA
+                PointCloudSoA = 13,
             };
 
         public:
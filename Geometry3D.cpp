@@ -9,6 +9,8 @@
 #include <Eigen/Dense>
 #include <numeric>
 
+#include "Logging.h"
+
 namespace pcd
 {
     namespace geometry
@@ -70,7 +72,7 @@ namespace pcd
             Eigen::Vector3d clipped_color = color;
             if (color.minCoeff() < 0 || color.maxCoeff() > 1)
             {
-                fprintf(stderr, "invalid color in PaintUniformColor, clipping to [0, 1]\n");
+                utility::LogWarning("invalid color in PaintUniformColor, clipping to [0, 1]\n");
                 clipped_color = clipped_color.array()
                                     .max(Eigen::Vector3d(0, 0, 0).array())
                                     .matrix();
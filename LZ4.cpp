@@ -0,0 +1,404 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+
+#include "LZ4.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <string.h>
+
+#include "BlockCodec.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// LZ4 block format
+//
+// A block is a list of sequences. Every sequence starts with a token byte,
+// LLLLMMMM: L literals follow the token, then a little-endian 16-bit offset
+// and a back reference of M + 4 bytes. A nibble of 15 continues in extra
+// bytes that are added to it, up to and including the first byte below 255.
+// The last sequence holds literals only and ends the block. Compressors keep
+// the last 5 bytes as literals and start no match in the last 12 bytes.
+//
+namespace
+{
+    const unsigned int kMinMatch = 4;
+    const unsigned int kLastLiterals = 5;
+    const unsigned int kMatchStartLimit = 12;
+    const unsigned int kMaxOffset = 65535;
+    const unsigned int kMaxHashLog = 16;
+
+    /// \brief How hard one compression level searches for matches.
+    ///
+    /// HLOG: the hash table has 1 << HLOG entries.
+    /// SKIP_LOG: after 1 << SKIP_LOG consecutive misses the search advances one
+    /// more byte per step.
+    template <int Level>
+    struct LZ4Level;
+
+    template <>
+    struct LZ4Level<pcd::io::CODEC_LEVEL_FAST>
+    {
+        static const unsigned int HLOG = 12, SKIP_LOG = 4;
+    };
+
+    template <>
+    struct LZ4Level<pcd::io::CODEC_LEVEL_DEFAULT>
+    {
+        static const unsigned int HLOG = 14, SKIP_LOG = 6;
+    };
+
+    template <>
+    struct LZ4Level<pcd::io::CODEC_LEVEL_BEST>
+    {
+        static const unsigned int HLOG = 16, SKIP_LOG = 8;
+    };
+
+    /// Per-thread hash table of input positions, stored as base + position so
+    /// that advancing base empties the table without clearing it.
+    struct LZ4HashTable
+    {
+        std::vector<std::uint32_t> slots = std::vector<std::uint32_t>(1 << kMaxHashLog, 0);
+        std::uint32_t base = 1;
+    };
+
+    LZ4HashTable &ThreadHashTable()
+    {
+        thread_local LZ4HashTable table;
+        return table;
+    }
+
+    inline std::uint32_t Load32(const unsigned char *p)
+    {
+        std::uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline std::uint64_t Load64(const unsigned char *p)
+    {
+        std::uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    template <unsigned int HLOG>
+    inline unsigned int Hash(const unsigned char *p)
+    {
+        return (Load32(p) * 2654435761u) >> (32 - HLOG);
+    }
+
+    /// Number of equal bytes at \p ip and \p ref, stopping at \p limit.
+    inline unsigned int MatchLength(const unsigned char *ip, const unsigned char *ref,
+                                    const unsigned char *limit)
+    {
+        const unsigned char *start = ip;
+        while (ip + 8 <= limit)
+        {
+            std::uint64_t diff = Load64(ip) ^ Load64(ref);
+            if (diff != 0)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                return (unsigned int)(ip - start) + (__builtin_clzll(diff) >> 3);
+#elif defined(_MSC_VER) && !defined(__clang__)
+                unsigned long index;
+                _BitScanForward64(&index, diff);
+                return (unsigned int)(ip - start) + (index >> 3);
+#else
+                return (unsigned int)(ip - start) + (__builtin_ctzll(diff) >> 3);
+#endif
+            }
+            ip += 8;
+            ref += 8;
+        }
+        while (ip < limit && *ip == *ref)
+        {
+            ip++;
+            ref++;
+        }
+        return (unsigned int)(ip - start);
+    }
+
+    /// Writes the extra bytes of \p len if it does not fit a token nibble and
+    /// returns the nibble.
+    inline unsigned char PutLength(size_t len, unsigned char *&op)
+    {
+        if (len < 15)
+        {
+            return (unsigned char)len;
+        }
+        for (len -= 15; len >= 255; len -= 255)
+        {
+            *op++ = 255;
+        }
+        *op++ = (unsigned char)len;
+        return 15;
+    }
+
+    /// Writes the literals [\p anchor, \p ip) followed by a back reference, or
+    /// the final literal run if \p len is 0. Returns `false` if the sequence
+    /// does not fit before \p out_end.
+    inline bool EmitSequence(const unsigned char *anchor, const unsigned char *ip,
+                             unsigned int offset, unsigned int len,
+                             unsigned char *&op, unsigned char *out_end)
+    {
+        size_t literals = ip - anchor;
+        size_t match = len > 0 ? len - kMinMatch : 0;
+        size_t worst = 1 + literals / 255 + 1 + literals + (len > 0 ? 2 + match / 255 + 1 : 0);
+        if ((size_t)(out_end - op) < worst)
+        {
+            return false;
+        }
+        unsigned char *token = op++;
+        *token = (unsigned char)(PutLength(literals, op) << 4);
+        memcpy(op, anchor, literals);
+        op += literals;
+        if (len > 0)
+        {
+            *op++ = (unsigned char)offset;
+            *op++ = (unsigned char)(offset >> 8);
+            *token |= PutLength(match, op);
+        }
+        return true;
+    }
+
+    template <int Level>
+    unsigned int CompressLevel(const unsigned char *in, unsigned int in_len,
+                               unsigned char *out, unsigned int out_len)
+    {
+        typedef LZ4Level<Level> L;
+        LZ4HashTable &table = ThreadHashTable();
+        if ((std::uint64_t)table.base + in_len >= UINT32_MAX)
+        {
+            std::fill(table.slots.begin(), table.slots.end(), 0);
+            table.base = 1;
+        }
+        std::uint32_t *slots = table.slots.data();
+        const std::uint32_t base = table.base;
+        table.base += in_len;
+
+        const unsigned char *in_end = in + in_len;
+        unsigned char *op = out;
+        unsigned char *out_end = out + out_len;
+        const unsigned char *anchor = in;
+        if (in_len > kMatchStartLimit)
+        {
+            const unsigned char *start_limit = in_end - kMatchStartLimit;
+            const unsigned char *end_limit = in_end - kLastLiterals;
+            const unsigned char *ip = in;
+            unsigned int misses = 0;
+            while (ip <= start_limit)
+            {
+                std::uint32_t &slot = slots[Hash<L::HLOG>(ip)];
+                std::uint32_t candidate = slot;
+                slot = base + (std::uint32_t)(ip - in);
+                // An invalid candidate compares ip against itself.
+                std::uint32_t offset = base + (std::uint32_t)(ip - in) - candidate;
+                bool valid = (candidate >= base) & (offset - 1 < kMaxOffset);
+                const unsigned char *ref = valid ? ip - offset : ip;
+                if (!(valid & (Load32(ref) == Load32(ip))))
+                {
+                    misses++;
+                    ip += 1 + (misses >> L::SKIP_LOG);
+                    continue;
+                }
+                misses = 0;
+                while (ip > anchor && ref > in && ip[-1] == ref[-1])
+                {
+                    ip--;
+                    ref--;
+                }
+                unsigned int len =
+                    kMinMatch + MatchLength(ip + kMinMatch, ref + kMinMatch, end_limit);
+                if (!EmitSequence(anchor, ip, offset, len, op, out_end))
+                {
+                    return 0;
+                }
+                ip += len;
+                anchor = ip;
+                // Seed the table from inside the match for the next search.
+                slots[Hash<L::HLOG>(ip - 2)] = base + (std::uint32_t)(ip - 2 - in);
+            }
+        }
+        if (!EmitSequence(anchor, in_end, 0, 0, op, out_end))
+        {
+            return 0;
+        }
+        return (unsigned int)(op - out);
+    }
+
+    /// Adds the extra bytes of a length nibble of 15 to \p len. Returns `false`
+    /// if they run past \p ip_end.
+    inline bool ReadLength(const unsigned char *&ip, const unsigned char *ip_end, size_t &len)
+    {
+        unsigned char extra;
+        do
+        {
+            if (ip >= ip_end)
+            {
+                return false;
+            }
+            extra = *ip++;
+            len += extra;
+        } while (extra == 255);
+        return true;
+    }
+
+    /// Copies a back reference of \p len bytes from \p offset bytes behind
+    /// \p op. Wide copies may write up to 7 bytes past op + len, which must
+    /// stay before \p out_end.
+    inline void CopyMatch(unsigned char *op, size_t offset, size_t len, unsigned char *out_end)
+    {
+        const unsigned char *ref = op - offset;
+        unsigned char *end = op + len;
+        if (offset == 1)
+        {
+            memset(op, *ref, len);
+        }
+        else if (end + 8 > out_end)
+        {
+            while (op < end)
+            {
+                *op++ = *ref++;
+            }
+        }
+        else if (offset >= 8)
+        {
+            for (; op < end; op += 8, ref += 8)
+            {
+                memcpy(op, ref, 8);
+            }
+        }
+        else
+        {
+            // Write one period by hand, then copy from a whole number of
+            // periods back so that every 8-byte copy reads written bytes.
+            for (int i = 0; i < 8; i++)
+            {
+                op[i] = ref[i];
+            }
+            size_t distance = offset * ((8 + offset - 1) / offset);
+            for (op += 8; op < end; op += 8)
+            {
+                memcpy(op, op - distance, 8);
+            }
+        }
+    }
+} // unnamed namespace
+
+unsigned int
+pcd::lz4CompressBound(unsigned int in_len)
+{
+    return in_len + in_len / 255 + 16;
+}
+
+unsigned int
+pcd::lz4Compress(const void *const in_data, unsigned int in_len,
+                 void *out_data, unsigned int out_len, int level)
+{
+    const auto *in = static_cast<const unsigned char *>(in_data);
+    auto *out = static_cast<unsigned char *>(out_data);
+    if (level <= io::CODEC_LEVEL_FAST)
+    {
+        return CompressLevel<io::CODEC_LEVEL_FAST>(in, in_len, out, out_len);
+    }
+    else if (level >= io::CODEC_LEVEL_BEST)
+    {
+        return CompressLevel<io::CODEC_LEVEL_BEST>(in, in_len, out, out_len);
+    }
+    return CompressLevel<io::CODEC_LEVEL_DEFAULT>(in, in_len, out, out_len);
+}
+
+unsigned int
+pcd::lz4Decompress(const void *const in_data, unsigned int in_len,
+                   void *out_data, unsigned int out_len)
+{
+    const auto *ip = static_cast<const unsigned char *>(in_data);
+    const unsigned char *const ip_end = ip + in_len;
+    auto *op = static_cast<unsigned char *>(out_data);
+    unsigned char *const out = op;
+    unsigned char *const out_end = op + out_len;
+    if (in_len == 0)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    for (;;)
+    {
+        unsigned int token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadLength(ip, ip_end, literals))
+        {
+            errno = EINVAL;
+            return 0;
+        }
+        if ((size_t)(out_end - op) < literals)
+        {
+            errno = E2BIG;
+            return 0;
+        }
+        if ((size_t)(ip_end - ip) < literals)
+        {
+            errno = EINVAL;
+            return 0;
+        }
+        if (literals <= 16 && ip_end - ip >= 16 && out_end - op >= 16)
+        {
+            memcpy(op, ip, 16);
+        }
+        else
+        {
+            memcpy(op, ip, literals);
+        }
+        ip += literals;
+        op += literals;
+        if (ip == ip_end)
+        {
+            break;
+        }
+
+        if (ip_end - ip < 2)
+        {
+            errno = EINVAL;
+            return 0;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - out))
+        {
+            errno = EINVAL;
+            return 0;
+        }
+        size_t len = token & 15;
+        if (len == 15 && !ReadLength(ip, ip_end, len))
+        {
+            errno = EINVAL;
+            return 0;
+        }
+        len += kMinMatch;
+        if ((size_t)(out_end - op) < len)
+        {
+            errno = E2BIG;
+            return 0;
+        }
+        CopyMatch(op, offset, len, out_end);
+        op += len;
+        // Only a literal run may end the block.
+        if (ip >= ip_end)
+        {
+            errno = EINVAL;
+            return 0;
+        }
+    }
+    return (unsigned int)(op - out);
+}
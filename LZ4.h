@@ -0,0 +1,51 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+namespace pcd
+{
+    /** \brief Largest output of \a lz4Compress for \a in_len input bytes. */
+    unsigned int lz4CompressBound(unsigned int in_len);
+
+    /** \brief Compress \a in_len bytes at \a in_data into the LZ4 block format
+     * at \a out_data, writing at most \a out_len bytes.
+     *
+     * The output is a single LZ4 block without frame header, readable by any
+     * LZ4 block decoder. It favours speed over ratio: matches are searched
+     * greedily with one hash probe per position.
+     *
+     * Return the number of bytes written, or 0 if the output buffer is too
+     * small. An output buffer of lz4CompressBound(in_len) bytes always fits.
+     *
+     * \param[in] in_data the input uncompressed buffer
+     * \param[in] in_len the length of the input buffer
+     * \param[out] out_data the output buffer where the compressed result will be stored
+     * \param[in] out_len the length of the output buffer
+     * \param[in] level one of the io::CODEC_LEVEL_* values of
+     * BlockCodec.h, trading hash table size and skipping over
+     * incompressible data against ratio
+     */
+    unsigned int
+    lz4Compress(const void *const in_data, unsigned int in_len,
+                void *out_data, unsigned int out_len, int level);
+
+    /** \brief Decompress the LZ4 block at \a in_data of \a in_len bytes into
+     * \a out_data, writing at most \a out_len bytes.
+     *
+     * Return the number of decompressed bytes. If the output buffer is too
+     * small a 0 is returned and errno is set to E2BIG; if the block is
+     * corrupt a 0 is returned and errno is set to EINVAL.
+     *
+     * \param[in] in_data the input compressed buffer
+     * \param[in] in_len the length of the input buffer
+     * \param[out] out_data the output buffer
+     * \param[in] out_len the length of the output buffer
+     */
+    unsigned int
+    lz4Decompress(const void *const in_data, unsigned int in_len,
+                  void *out_data, unsigned int out_len);
+}
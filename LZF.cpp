@@ -9,274 +9,410 @@
 #include <cerrno>
 #include <climits>
 #include <cstddef>
+#include <cstdint>
 #include <algorithm>
+#include <vector>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-/*
- * Size of hashtable is (1 << HLOG) * sizeof (char *)
- * decompression is independent of the hash table size
- * the difference between 15 and 14 is very small
- * for small blocks (and 14 is usually a bit faster).
- * For a low-memory/faster configuration, use HLOG == 13;
- * For best compression, use 15 or 16 (or more, up to 22).
- */
-#define HLOG 13
-
-using LZF_HSLOT = unsigned int;
-using LZF_STATE = unsigned int[1 << (HLOG)];
-
-#if !(defined(__i386) || defined(__amd64))
-#define STRICT_ALIGN 1
-#else
-#define STRICT_ALIGN 0
-#endif
-#if !STRICT_ALIGN
-/* for unaligned accesses we need a 16 bit datatype. */
-#if USHRT_MAX == 65535
-using u16 = unsigned short;
-#elif UINT_MAX == 65535
-using u16 = unsigned int;
-#else
-#undef STRICT_ALIGN
-#define STRICT_ALIGN 1
-#endif
-#endif
+#include "BlockCodec.h"
+#include "Logging.h"
 
-// IDX works because it is very similar to a multiplicative hash, e.g.
-// ((h * 57321 >> (3*8 - HLOG)) & ((1 << (HLOG)) - 1))
-#define IDX(h) (((h >> (3 * 8 - HLOG)) - h) & ((1 << (HLOG)) - 1))
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
 
-///////////////////////////////////////////////////////////////////////////////////////////
-//
-// compressed format
-//
-// 000LLLLL <L+1>    ; literal, L+1=1..33 octets
-// LLLooooo oooooooo ; backref L+1=1..7 octets, o+1=1..4096 offset
-// 111ooooo LLLLLLLL oooooooo ; backref L+8 octets, o+1=1..4096 offset
-//
-//
-unsigned int
-pcd::lzfCompress(const void *const in_data, unsigned int in_len,
-                 void *out_data, unsigned int out_len)
+namespace
 {
-    LZF_STATE htab{};
-    const auto *ip = static_cast<const unsigned char *>(in_data);
-    auto *op = static_cast<unsigned char *>(out_data);
-    const unsigned char *in_end = ip + in_len;
-    unsigned char *out_end = op + out_len;
+    // Format limits: back references reach 8192 bytes back, copy 3 to 264
+    // bytes, and literal runs hold at most 32 bytes.
+    const unsigned int kMaxOffset = 1 << 13;
+    const unsigned int kMinMatch = 3;
+    const unsigned int kMaxMatch = (1 << 8) + (1 << 3);
+    const unsigned int kMaxLiteral = 1 << 5;
+    const unsigned int kMaxHashLog = 16;
+
+    /// \brief How hard one compression level searches for matches.
+    ///
+    /// HLOG: the hash table has 1 << HLOG entries. Decompression does not
+    /// depend on it; larger tables find more distant matches.
+    /// REHASH: positions inside a match added to the hash table, 1 hashes only
+    /// the last one, 2 the last two, 0 all of them.
+    /// SKIP_LOG: after 1 << SKIP_LOG consecutive misses the search advances one
+    /// more byte per step, which speeds through incompressible data. 0 disables
+    /// skipping.
+    /// LAZY: looks one byte ahead for a match that reaches further.
+    template <int Level>
+    struct LZFLevel;
+
+    template <>
+    struct LZFLevel<pcd::io::CODEC_LEVEL_FAST>
+    {
+        static const unsigned int HLOG = 13, REHASH = 1, SKIP_LOG = 5;
+        static const bool LAZY = false;
+    };
 
-    if (!in_len || !out_len)
+    template <>
+    struct LZFLevel<pcd::io::CODEC_LEVEL_DEFAULT>
     {
-        fprintf(stderr, "[lzf_compress] Input or output has 0 size!\n");
-        return (0);
+        static const unsigned int HLOG = 16, REHASH = 0, SKIP_LOG = 0;
+        static const bool LAZY = false;
+    };
+
+    template <>
+    struct LZFLevel<pcd::io::CODEC_LEVEL_BEST>
+    {
+        static const unsigned int HLOG = 16, REHASH = 0, SKIP_LOG = 0;
+        static const bool LAZY = true;
+    };
+
+    /// Per-thread hash table of input positions. Entries hold base + position
+    /// so that advancing base empties the table without clearing it, and the
+    /// output only depends on the input and level.
+    struct LZFHashTable
+    {
+        std::vector<std::uint32_t> slots = std::vector<std::uint32_t>(1 << kMaxHashLog, 0);
+        std::uint32_t base = 1;
+    };
+
+    LZFHashTable &ThreadHashTable()
+    {
+        thread_local LZFHashTable table;
+        return table;
     }
 
-    // Start run
-    int lit = 0;
-    op++;
+    inline std::uint32_t Load32(const unsigned char *p)
+    {
+        std::uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
 
-    unsigned int hval = (ip[0] << 8) | ip[1];
-    while (ip < in_end - 2)
+    inline std::uint64_t Load64(const unsigned char *p)
     {
-        unsigned int *hslot;
-
-        hval = (hval << 8) | ip[2];
-        hslot = htab + IDX(hval);
-        const unsigned char *ref = *hslot + (static_cast<const unsigned char *>(in_data));
-        *hslot = static_cast<unsigned int>(ip - (static_cast<const unsigned char *>(in_data)));
-
-        // off requires a type wide enough to hold a general pointer difference.
-        // ISO C doesn't have that (std::size_t might not be enough and ptrdiff_t only
-        // works for differences within a single object). We also assume that no
-        // no bit pattern traps. Since the only platform that is both non-POSIX
-        // and fails to support both assumptions is windows 64 bit, we make a
-        // special workaround for it.
-#if defined(_WIN32) && defined(_M_X64) && defined(_MSC_VER)
-        // workaround for missing POSIX compliance
-        unsigned _int64 off;
+        std::uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    const bool kLittleEndian = false;
 #else
-        unsigned long off;
+    const bool kLittleEndian = true;
 #endif
 
-        if (
-            // The next test will actually take care of this, but this is faster if htab is initialized
-            ref < ip && (off = ip - ref - 1) < (1 << 13) && ref > static_cast<const unsigned char *>(in_data) && ref[2] == ip[2]
-#if STRICT_ALIGN
-            && ((ref[1] << 8) | ref[0]) == ((ip[1] << 8) | ip[0])
+    /// The three bytes at \p p, which must be followed by a readable byte.
+    inline std::uint32_t Load3(const unsigned char *p)
+    {
+        return kLittleEndian ? Load32(p) & 0xffffff : Load32(p) >> 8;
+    }
+
+    template <unsigned int HLOG>
+    inline unsigned int Hash(const unsigned char *p)
+    {
+        return (Load3(p) * 2654435761u) >> (32 - HLOG);
+    }
+
+    inline unsigned int CountTrailingZeroBytes(std::uint64_t v)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward64(&index, v);
+        return index >> 3;
 #else
-            && *reinterpret_cast<const u16 *>(ref) == *reinterpret_cast<const u16 *>(ip)
+        return __builtin_ctzll(v) >> 3;
 #endif
-        )
-        {
-            // Match found at *ref++
-            unsigned int len = 2;
-            std::ptrdiff_t maxlen = in_end - ip - len;
-            maxlen = maxlen > ((1 << 8) + (1 << 3)) ? ((1 << 8) + (1 << 3)) : maxlen;
+    }
 
-            // First a faster conservative test
-            if (op + 3 + 1 >= out_end)
+    /// Number of equal bytes at \p ip and \p ref, comparing 8 bytes at a time
+    /// and stopping at \p limit.
+    inline unsigned int MatchLength(const unsigned char *ip, const unsigned char *ref,
+                                    const unsigned char *limit)
+    {
+        const unsigned char *start = ip;
+        if (kLittleEndian)
+        {
+            while (ip + 8 <= limit)
             {
-                // Second the exact but rare test
-                if (op - !lit + 3 + 1 >= out_end)
+                std::uint64_t diff = Load64(ip) ^ Load64(ref);
+                if (diff != 0)
                 {
-                    fprintf(stderr, "[lzf_compress] Attempting to write data outside the output buffer!\n");
-                    return (0);
+                    return (unsigned int)(ip - start) + CountTrailingZeroBytes(diff);
                 }
+                ip += 8;
+                ref += 8;
             }
+        }
+        while (ip < limit && *ip == *ref)
+        {
+            ip++;
+            ref++;
+        }
+        return (unsigned int)(ip - start);
+    }
 
-            // Stop run
-            op[-lit - 1] = static_cast<unsigned char>(lit - 1);
-            // Undo run if length is zero
-            op -= !lit;
-
-            while (true)
-            {
-                if (maxlen > 16)
-                {
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                    len++;
-                    if (ref[len] != ip[len])
-                        break;
-                }
+    /// Length of the match between \p ip and the position \p candidate from the
+    /// hash table, or 0 if the candidate is empty, out of reach or not ahead of
+    /// \p ip. \p ip must have 4 readable bytes.
+    inline unsigned int MatchAt(std::uint32_t candidate, std::uint32_t base,
+                                const unsigned char *in, const unsigned char *ip,
+                                const unsigned char *in_end, const unsigned char *&ref)
+    {
+        // Random data mostly misses, so the checks are combined without
+        // branches; an invalid candidate compares ip against itself.
+        std::uint32_t offset = base + (std::uint32_t)(ip - in) - candidate;
+        bool valid = (candidate >= base) & (offset - 1 < kMaxOffset);
+        ref = valid ? ip - offset : ip;
+        if (!(valid & (Load3(ref) == Load3(ip))))
+        {
+            return 0;
+        }
+        const unsigned char *limit = std::min(in_end, ip + kMaxMatch);
+        return kMinMatch + MatchLength(ip + kMinMatch, ref + kMinMatch, limit);
+    }
 
-                do
-                    len++;
-                while (len < static_cast<unsigned int>(maxlen) && ref[len] == ip[len]);
+    /// Output bytes of a back reference of \p len bytes.
+    inline unsigned int MatchCost(unsigned int len) { return len - 2 < 7 ? 2 : 3; }
 
-                break;
+    /// Writes the literal runs of [\p begin, \p end). Returns `false` if they do
+    /// not fit before \p out_end.
+    inline bool EmitLiterals(const unsigned char *begin, const unsigned char *end,
+                             unsigned char *&op, unsigned char *out_end)
+    {
+        while (begin < end)
+        {
+            unsigned int run = (unsigned int)std::min<std::ptrdiff_t>(end - begin, kMaxLiteral);
+            if (op + 1 + run > out_end)
+            {
+                return false;
             }
+            *op++ = (unsigned char)(run - 1);
+            memcpy(op, begin, run);
+            op += run;
+            begin += run;
+        }
+        return true;
+    }
 
-            // Len is now #octets - 1
-            len -= 2;
-            ip++;
+    inline bool EmitMatch(unsigned int offset, unsigned int len,
+                          unsigned char *&op, unsigned char *out_end)
+    {
+        if (op + 3 > out_end)
+        {
+            return false;
+        }
+        // offset and len are stored minus one and minus two
+        unsigned int off = offset - 1;
+        len -= 2;
+        if (len < 7)
+        {
+            *op++ = (unsigned char)((off >> 8) + (len << 5));
+        }
+        else
+        {
+            *op++ = (unsigned char)((off >> 8) + (7 << 5));
+            *op++ = (unsigned char)(len - 7);
+        }
+        *op++ = (unsigned char)off;
+        return true;
+    }
 
-            if (len < 7)
+    template <int Level>
+    unsigned int CompressLevel(const unsigned char *in, unsigned int in_len,
+                               unsigned char *out, unsigned int out_len)
+    {
+        typedef LZFLevel<Level> L;
+        LZFHashTable &table = ThreadHashTable();
+        if ((std::uint64_t)table.base + in_len >= UINT32_MAX)
+        {
+            std::fill(table.slots.begin(), table.slots.end(), 0);
+            table.base = 1;
+        }
+        std::uint32_t *slots = table.slots.data();
+        const std::uint32_t base = table.base;
+        table.base += in_len;
+
+        const unsigned char *in_end = in + in_len;
+        unsigned char *op = out;
+        unsigned char *out_end = out + out_len;
+        // pending literals start at anchor
+        const unsigned char *anchor = in;
+        const unsigned char *ip = in;
+        unsigned int misses = 0;
+
+        while (ip + kMinMatch < in_end)
+        {
+            std::uint32_t &slot = slots[Hash<L::HLOG>(ip)];
+            const unsigned char *ref = NULL;
+            unsigned int len = MatchAt(slot, base, in, ip, in_end, ref);
+            slot = base + (std::uint32_t)(ip - in);
+            if (len == 0)
             {
-                *op++ = static_cast<unsigned char>((off >> 8) + (len << 5));
+                misses++;
+                ip += L::SKIP_LOG == 0 ? 1 : 1 + (misses >> L::SKIP_LOG);
+                continue;
             }
-            else
+            misses = 0;
+            // Start one byte later instead if that match reaches further at no
+            // higher cost than this match followed by the one after it.
+            while (L::LAZY && len < kMaxMatch && ip + 1 + kMinMatch < in_end)
             {
-                *op++ = static_cast<unsigned char>((off >> 8) + (7 << 5));
-                *op++ = static_cast<unsigned char>(len - 7);
+                std::uint32_t &next_slot = slots[Hash<L::HLOG>(ip + 1)];
+                const unsigned char *next_ref = NULL;
+                unsigned int next_len = MatchAt(next_slot, base, in, ip + 1, in_end, next_ref);
+                next_slot = base + (std::uint32_t)(ip + 1 - in);
+                const unsigned char *after_ref = NULL;
+                unsigned int after_len =
+                    ip + len + kMinMatch < in_end
+                        ? MatchAt(slots[Hash<L::HLOG>(ip + len)], base, in, ip + len, in_end, after_ref)
+                        : 0;
+                unsigned int greedy_cover = len + after_len;
+                unsigned int greedy_cost = MatchCost(len) + (after_len ? MatchCost(after_len) : 0);
+                unsigned int lazy_cover = next_len + 1;
+                unsigned int lazy_cost = MatchCost(next_len) + (ip == anchor ? 2 : 1);
+                bool further = next_len > 0 && lazy_cover > greedy_cover &&
+                               lazy_cost <= greedy_cost + (lazy_cover - greedy_cover);
+                bool cheaper = next_len > 0 && lazy_cover == greedy_cover && lazy_cost < greedy_cost;
+                if (!further && !cheaper)
+                {
+                    break;
+                }
+                ip++;
+                ref = next_ref;
+                len = next_len;
             }
-
-            *op++ = static_cast<unsigned char>(off);
-
-            // Start run
-            lit = 0;
-            op++;
-
-            ip += len + 1;
-
-            if (ip >= in_end - 2)
-                break;
-
-            --ip;
-            hval = (ip[0] << 8) | ip[1];
-
-            hval = (hval << 8) | ip[2];
-            htab[IDX(hval)] = static_cast<unsigned int>(ip - (static_cast<const unsigned char *>(in_data)));
-            ip++;
-        }
-        else
-        {
-            // One more literal byte we must copy
-            if (op >= out_end)
+            if (!EmitLiterals(anchor, ip, op, out_end) ||
+                !EmitMatch((unsigned int)(ip - ref), len, op, out_end))
             {
-                fprintf(stderr, "[lzf_compress] Attempting to copy data outside the output buffer!\n");
-                return (0);
+                return 0;
             }
 
-            lit++;
-            *op++ = *ip++;
-
-            if (lit == (1 << 5))
+            // Feed positions covered by the match to the table.
+            const unsigned char *end = ip + len;
+            const unsigned char *hash_end = std::min(end, in_end - kMinMatch);
+            for (const unsigned char *p = L::REHASH == 0 ? ip + 1 : end - L::REHASH; p < hash_end; p++)
             {
-                // Stop run
-                op[-lit - 1] = static_cast<unsigned char>(lit - 1);
-                // Start run
-                lit = 0;
-                op++;
+                slots[Hash<L::HLOG>(p)] = base + (std::uint32_t)(p - in);
             }
+            ip = anchor = end;
+        }
+        if (!EmitLiterals(anchor, in_end, op, out_end))
+        {
+            return 0;
         }
+        return (unsigned int)(op - out);
     }
+} // unnamed namespace
 
-    // At most 3 bytes can be missing here
-    if (op + 3 > out_end)
-        return (0);
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// compressed format
+//
+// 000LLLLL <L+1>    ; literal, L+1=1..33 octets
+// LLLooooo oooooooo ; backref L+1=1..7 octets, o+1=1..4096 offset
+// 111ooooo LLLLLLLL oooooooo ; backref L+8 octets, o+1=1..4096 offset
+//
+//
+unsigned int
+pcd::lzfCompress(const void *const in_data, unsigned int in_len,
+                 void *out_data, unsigned int out_len)
+{
+    return lzfCompress(in_data, in_len, out_data, out_len, io::CODEC_LEVEL_DEFAULT);
+}
 
-    while (ip < in_end)
+unsigned int
+pcd::lzfCompress(const void *const in_data, unsigned int in_len,
+                 void *out_data, unsigned int out_len, int level)
+{
+    if (!in_len || !out_len)
     {
-        lit++;
-        *op++ = *ip++;
+        pcd::utility::LogError("[lzf_compress] Input or output has 0 size!\n");
+        return (0);
+    }
+    const auto *in = static_cast<const unsigned char *>(in_data);
+    auto *out = static_cast<unsigned char *>(out_data);
+    unsigned int size;
+    if (level <= io::CODEC_LEVEL_FAST)
+    {
+        size = CompressLevel<io::CODEC_LEVEL_FAST>(in, in_len, out, out_len);
+    }
+    else if (level >= io::CODEC_LEVEL_BEST)
+    {
+        size = CompressLevel<io::CODEC_LEVEL_BEST>(in, in_len, out, out_len);
+    }
+    else
+    {
+        size = CompressLevel<io::CODEC_LEVEL_DEFAULT>(in, in_len, out, out_len);
+    }
+    if (size == 0)
+    {
+        pcd::utility::LogError("[lzf_compress] Attempting to write data outside the output buffer!\n");
+    }
+    return size;
+}
 
-        if (lit == (1 << 5))
+///////////////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+    inline void Copy8(unsigned char *dst, const unsigned char *src) { memcpy(dst, src, 8); }
+    inline void Copy16(unsigned char *dst, const unsigned char *src) { memcpy(dst, src, 16); }
+
+    /// Copies a back reference of \p len bytes from \p offset bytes behind
+    /// \p op. Wide copies may write up to 15 bytes past op + len, which the
+    /// caller guarantees stay before \p out_end.
+    inline void CopyMatch(unsigned char *op, unsigned int offset, unsigned int len,
+                          unsigned char *out_end)
+    {
+        const unsigned char *ref = op - offset;
+        unsigned char *end = op + len;
+        if (offset >= 16 && end + 16 <= out_end)
+        {
+            do
+            {
+                Copy16(op, ref);
+                op += 16;
+                ref += 16;
+            } while (op < end);
+        }
+        else if (offset >= 8 && end + 8 <= out_end)
+        {
+            do
+            {
+                Copy8(op, ref);
+                op += 8;
+                ref += 8;
+            } while (op < end);
+        }
+        else if (offset == 1)
         {
-            // Stop run
-            op[-lit - 1] = static_cast<unsigned char>(lit - 1);
-            // Start run
-            lit = 0;
-            op++;
+            // runs of one byte, e.g. repeated exponents in float stripes
+            memset(op, *ref, len);
+        }
+        else if (end + 8 <= out_end)
+        {
+            // Short overlapping periods: write the first 8 bytes one by one,
+            // then copy from a whole number of periods back, at least 8 bytes
+            // away, so every 8-byte copy reads bytes already written.
+            for (int i = 0; i < 8; i++)
+            {
+                op[i] = ref[i];
+            }
+            unsigned int distance = offset * ((8 + offset - 1) / offset);
+            for (op += 8; op < end; op += 8)
+            {
+                Copy8(op, op - distance);
+            }
+        }
+        else
+        {
+            do
+                *op++ = *ref++;
+            while (op < end);
         }
     }
+} // unnamed namespace
 
-    // End run
-    op[-lit - 1] = static_cast<unsigned char>(lit - 1);
-    // Undo run if length is zero
-    op -= !lit;
-
-    return (static_cast<unsigned int>(op - static_cast<unsigned char *>(out_data)));
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////
 unsigned int
 pcd::lzfDecompress(const void *const in_data, unsigned int in_len,
                    void *out_data, unsigned int out_len)
@@ -286,6 +422,11 @@ pcd::lzfDecompress(const void *const in_data, unsigned int in_len,
     unsigned char const *const in_end = ip + in_len;
     unsigned char *const out_end = op + out_len;
 
+    if (in_len == 0)
+    {
+        errno = EINVAL;
+        return (0);
+    }
     do
     {
         unsigned int ctrl = *ip++;
@@ -307,15 +448,26 @@ pcd::lzfDecompress(const void *const in_data, unsigned int in_len,
                 errno = EINVAL;
                 return (0);
             }
-            for (unsigned ctrl_c = ctrl; ctrl_c; --ctrl_c)
-                *op++ = *ip++;
+            // Runs hold at most 32 bytes; copy all of them when both buffers
+            // have room and advance by the real length.
+            if (ip + 32 <= in_end && op + 32 <= out_end)
+            {
+                Copy16(op, ip);
+                Copy16(op + 16, ip + 16);
+            }
+            else
+            {
+                memcpy(op, ip, ctrl);
+            }
+            op += ctrl;
+            ip += ctrl;
         }
         // Back reference
         else
         {
             unsigned int len = ctrl >> 5;
 
-            unsigned char *ref = op - ((ctrl & 0x1f) << 8) - 1;
+            unsigned int offset = ((ctrl & 0x1f) << 8) + 1;
 
             // Check for overflow
             if (ip >= in_end)
@@ -333,41 +485,23 @@ pcd::lzfDecompress(const void *const in_data, unsigned int in_len,
                     return (0);
                 }
             }
-            ref -= *ip++;
+            offset += *ip++;
+            len += 2;
 
-            if (op + len + 2 > out_end)
+            if (op + len > out_end)
             {
                 errno = E2BIG;
                 return (0);
             }
 
-            if (ref < static_cast<unsigned char *>(out_data))
+            if (offset > (std::size_t)(op - static_cast<unsigned char *>(out_data)))
             {
                 errno = EINVAL;
                 return (0);
             }
 
-            if (len > 9)
-            {
-                len += 2;
-
-                if (op >= ref + len)
-                {
-                    // Disjunct
-                    std::copy(ref, ref + len, op);
-                    op += len;
-                }
-                else
-                {
-                    // Overlapping, use byte by byte copying
-                    do
-                        *op++ = *ref++;
-                    while (--len);
-                }
-            }
-            else
-                for (unsigned len_c = len + 2 /* case 0 iterates twice */; len_c; --len_c)
-                    *op++ = *ref++;
+            CopyMatch(op, offset, len, out_end);
+            op += len;
         }
     } while (ip < in_end);
 
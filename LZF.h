@@ -31,6 +31,15 @@ namespace pcd
     lzfCompress(const void *const in_data, unsigned int in_len,
                 void *out_data, unsigned int out_len);
 
+    /** \brief Same as above at compression \a level, one of the
+     * io::CODEC_LEVEL_* values of BlockCodec.h. Every level is decodable by any
+     * LZF decoder, and the output only depends on the input and the level. The
+     * best level adds lazy matching.
+     */
+    unsigned int
+    lzfCompress(const void *const in_data, unsigned int in_len,
+                void *out_data, unsigned int out_len, int level);
+
     /** \brief Decompress data compressed with the \a lzfCompress function and
      * stored at location \a in_data and length \a in_len. The result will be
      * stored at \a out_data up to a maximum of \a out_len characters.
@@ -0,0 +1,98 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "Logging.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace pcd
+{
+    namespace utility
+    {
+        namespace
+        {
+            VerbosityLevel InitialVerbosityLevel()
+            {
+                const char *env = getenv("PCDIO_LOG_LEVEL");
+                if (env != NULL)
+                {
+                    if (strcmp(env, "error") == 0)
+                    {
+                        return VerbosityLevel::Error;
+                    }
+                    if (strcmp(env, "info") == 0)
+                    {
+                        return VerbosityLevel::Info;
+                    }
+                    if (strcmp(env, "debug") == 0)
+                    {
+                        return VerbosityLevel::Debug;
+                    }
+                }
+                return VerbosityLevel::Warning;
+            }
+
+            std::atomic<VerbosityLevel> &CurrentLevel()
+            {
+                static std::atomic<VerbosityLevel> level(InitialVerbosityLevel());
+                return level;
+            }
+
+            void LogV(VerbosityLevel level, const char *format, va_list args)
+            {
+                if (IsLogEnabled(level))
+                {
+                    vfprintf(stderr, format, args);
+                }
+            }
+        } // unnamed namespace
+
+        void SetVerbosityLevel(VerbosityLevel level)
+        {
+            CurrentLevel().store(level, std::memory_order_relaxed);
+        }
+
+        VerbosityLevel GetVerbosityLevel()
+        {
+            return CurrentLevel().load(std::memory_order_relaxed);
+        }
+
+        void LogError(const char *format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+            LogV(VerbosityLevel::Error, format, args);
+            va_end(args);
+        }
+
+        void LogWarning(const char *format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+            LogV(VerbosityLevel::Warning, format, args);
+            va_end(args);
+        }
+
+        void LogInfo(const char *format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+            LogV(VerbosityLevel::Info, format, args);
+            va_end(args);
+        }
+
+        void LogDebug(const char *format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+            LogV(VerbosityLevel::Debug, format, args);
+            va_end(args);
+        }
+    } // namespace utility
+} // namespace pcd
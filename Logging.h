@@ -0,0 +1,57 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include "Geometry.h"
+
+#if defined __GNUC__ || defined __clang__
+#define PCDIO_PRINTF_FORMAT(format_index, args_index) \
+    __attribute__((format(printf, format_index, args_index)))
+#else
+#define PCDIO_PRINTF_FORMAT(format_index, args_index)
+#endif
+
+namespace pcd
+{
+    namespace utility
+    {
+        /// \enum VerbosityLevel
+        ///
+        /// \brief Messages up to the current level are printed to stderr.
+        enum class VerbosityLevel
+        {
+            /// Failures only. Messages at this level are always printed.
+            Error = 0,
+            /// Suspicious input that was handled anyway.
+            Warning = 1,
+            /// Summaries of completed operations.
+            Info = 2,
+            /// Per-file details such as header dumps.
+            Debug = 3,
+        };
+
+        /// \brief Sets the level for the whole process.
+        ///
+        /// The initial level is Warning, or the value of the PCDIO_LOG_LEVEL
+        /// environment variable ("error", "warning", "info" or "debug").
+        PCDIO_EXPORTS void SetVerbosityLevel(VerbosityLevel level);
+        PCDIO_EXPORTS VerbosityLevel GetVerbosityLevel();
+
+        /// Returns `true` if messages of \p level are printed, to skip building
+        /// expensive messages.
+        inline bool IsLogEnabled(VerbosityLevel level)
+        {
+            return level <= GetVerbosityLevel();
+        }
+
+        /// printf-style logging to stderr. The format is printed as given, so
+        /// messages end with their own newline.
+        PCDIO_EXPORTS void LogError(const char *format, ...) PCDIO_PRINTF_FORMAT(1, 2);
+        PCDIO_EXPORTS void LogWarning(const char *format, ...) PCDIO_PRINTF_FORMAT(1, 2);
+        PCDIO_EXPORTS void LogInfo(const char *format, ...) PCDIO_PRINTF_FORMAT(1, 2);
+        PCDIO_EXPORTS void LogDebug(const char *format, ...) PCDIO_PRINTF_FORMAT(1, 2);
+    } // namespace utility
+} // namespace pcd
@@ -0,0 +1,145 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pcd
+{
+    namespace io
+    {
+        MappedFile::~MappedFile() { Close(); }
+
+        bool MappedFile::Open(const std::string &filename)
+        {
+            Close();
+#if defined _WIN32
+            HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                      NULL, OPEN_EXISTING,
+                                      FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size))
+            {
+                CloseHandle(file);
+                return false;
+            }
+            if (file_size.QuadPart > 0)
+            {
+                HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (mapping != NULL)
+                {
+                    mapping_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                    // The view keeps the mapping object alive.
+                    CloseHandle(mapping);
+                }
+            }
+            CloseHandle(file);
+            size_ = (std::size_t)file_size.QuadPart;
+#else
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                close(fd);
+                return false;
+            }
+            if (S_ISREG(st.st_mode) && st.st_size > 0)
+            {
+                void *ptr = mmap(NULL, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ptr != MAP_FAILED)
+                {
+                    mapping_ = ptr;
+                    // PCD payloads are always consumed front to back.
+                    posix_madvise(ptr, (std::size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+                }
+            }
+            close(fd);
+            size_ = S_ISREG(st.st_mode) ? (std::size_t)st.st_size : 0;
+#endif
+            if (mapping_ != nullptr)
+            {
+                data_ = static_cast<const char *>(mapping_);
+                is_open_ = true;
+                return true;
+            }
+            return ReadIntoBuffer(filename);
+        }
+
+        void MappedFile::Close()
+        {
+            if (mapping_ != nullptr)
+            {
+#if defined _WIN32
+                UnmapViewOfFile(mapping_);
+#else
+                munmap(mapping_, size_);
+#endif
+                mapping_ = nullptr;
+            }
+            buffer_.reset();
+            data_ = nullptr;
+            size_ = 0;
+            is_open_ = false;
+        }
+
+        bool MappedFile::ReadIntoBuffer(const std::string &filename)
+        {
+            FILE *file = fopen(filename.c_str(), "rb");
+            if (file == NULL)
+            {
+                return false;
+            }
+            // The size is unknown for non-regular files, so grow as we go.
+            std::size_t capacity = size_ > 0 ? size_ + 1 : 1 << 16;
+            std::size_t length = 0;
+            std::unique_ptr<char[]> buffer(new char[capacity]);
+            while (true)
+            {
+                length += fread(buffer.get() + length, 1, capacity - length, file);
+                if (length < capacity)
+                {
+                    break;
+                }
+                std::unique_ptr<char[]> grown(new char[capacity * 2]);
+                std::copy(buffer.get(), buffer.get() + length, grown.get());
+                buffer.swap(grown);
+                capacity *= 2;
+            }
+            bool failed = ferror(file) != 0;
+            fclose(file);
+            if (failed)
+            {
+                return false;
+            }
+            buffer_.swap(buffer);
+            data_ = buffer_.get();
+            size_ = length;
+            is_open_ = true;
+            return true;
+        }
+    } // namespace io
+} // namespace pcd
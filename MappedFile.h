@@ -0,0 +1,63 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "Geometry.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        /// \class MappedFile
+        ///
+        /// \brief Read-only view of a whole file.
+        ///
+        /// The file is memory mapped where the platform supports it, so readers
+        /// can parse and decode straight from the page cache without copying.
+        /// If mapping fails (e.g. for pipes or special files) the contents are
+        /// read into a heap buffer instead, so callers only ever see a
+        /// contiguous [Data(), Data() + Size()) range.
+        class PCDIO_EXPORTS MappedFile
+        {
+        public:
+            MappedFile() = default;
+            ~MappedFile();
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+
+        public:
+            /// Maps \p filename, closing any previously opened file first.
+            bool Open(const std::string &filename);
+            /// Unmaps the file and releases the fallback buffer, if any.
+            void Close();
+
+            /// Returns `true` if a file is currently open.
+            bool IsOpen() const { return is_open_; }
+            /// Returns `true` if the contents are served from a memory mapping.
+            bool IsMapped() const { return mapping_ != nullptr; }
+            /// First byte of the file contents.
+            const char *Data() const { return data_; }
+            /// Size of the file contents in bytes.
+            std::size_t Size() const { return size_; }
+
+        private:
+            bool ReadIntoBuffer(const std::string &filename);
+
+        private:
+            const char *data_ = nullptr;
+            std::size_t size_ = 0;
+            bool is_open_ = false;
+            /// Start of the mapped view, nullptr when not mapped.
+            void *mapping_ = nullptr;
+            /// Contents when the file could not be mapped.
+            std::unique_ptr<char[]> buffer_;
+        };
+    } // namespace io
+} // namespace pcd
@@ -0,0 +1,2103 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "PCDFormat.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include <string.h>
+
+#include "Logging.h"
+#include "SimdConvert.h"
+#include "ThreadPool.h"
+
+// Bytes of ASCII data per chunk when parsing in parallel.
+#define PCD_ASCII_CHUNK_BYTES (1 << 20)
+// Points per chunk when decoding binary records in parallel, a multiple of
+// PCD_RECORD_BLOCK_POINTS. Files of fewer than two chunks decode serially.
+#define PCD_BINARY_CHUNK_POINTS (1 << 16)
+// Upper bound on the length of one formatted ASCII value.
+#define PCD_ASCII_TOKEN_BYTES 32
+
+namespace pcd
+{
+    namespace io
+    {
+        namespace
+        {
+            using namespace internal;
+
+            std::vector<std::string> SplitString(const std::string &str,
+                                                 const std::string &delimiters /* = " "*/,
+                                                 bool trim_empty_str = true)
+            {
+                std::vector<std::string> tokens;
+                std::string::size_type pos = 0, new_pos = 0, last_pos = 0;
+                while (pos != std::string::npos)
+                {
+                    pos = str.find_first_of(delimiters, last_pos);
+                    new_pos = (pos == std::string::npos ? str.length() : pos);
+                    if (new_pos != last_pos || !trim_empty_str)
+                    {
+                        tokens.push_back(str.substr(last_pos, new_pos - last_pos));
+                    }
+                    last_pos = new_pos + 1;
+                }
+                return tokens;
+            }
+
+            Eigen::Vector3d ColorToDouble(uint8_t r, uint8_t g, uint8_t b)
+            {
+                return Eigen::Vector3d(r, g, b) / 255.0;
+            }
+
+            typedef Eigen::Matrix<uint8_t, 3, 1> Vector3uint8;
+            Vector3uint8 ColorToUint8(const Eigen::Vector3d &color)
+            {
+                Vector3uint8 rgb;
+                for (int i = 0; i < 3; ++i)
+                {
+                    rgb[i] = uint8_t(
+                        std::round(std::min(1., std::max(0., color(i))) * 255.));
+                }
+                return rgb;
+            }
+
+            template <typename Src, typename Dst>
+            void ConvertColumn(const char *src, size_t src_stride,
+                               char *dst, size_t dst_stride, size_t count)
+            {
+                if (std::is_same<Src, Dst>::value && src_stride == sizeof(Src) &&
+                    dst_stride == sizeof(Dst))
+                {
+                    memcpy(dst, src, count * sizeof(Src));
+                    return;
+                }
+                for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                {
+                    Src value;
+                    memcpy(&value, src, sizeof(value));
+                    Dst converted = (Dst)value;
+                    memcpy(dst, &converted, sizeof(converted));
+                }
+            }
+
+            template <typename Dst>
+            void ZeroColumn(const char *, size_t,
+                            char *dst, size_t dst_stride, size_t count)
+            {
+                const Dst zero = Dst(0);
+                for (size_t i = 0; i < count; i++, dst += dst_stride)
+                {
+                    memcpy(dst, &zero, sizeof(zero));
+                }
+            }
+
+            void DecodeColorColumn(const char *src, size_t src_stride,
+                                   char *dst, size_t dst_stride, size_t count)
+            {
+                for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                {
+                    // color data is packed in BGR order.
+                    const auto *data = reinterpret_cast<const std::uint8_t *>(src);
+                    *reinterpret_cast<Eigen::Vector3d *>(dst) =
+                        ColorToDouble(data[2], data[1], data[0]);
+                }
+            }
+
+            void ZeroColorColumn(const char *, size_t,
+                                 char *dst, size_t dst_stride, size_t count)
+            {
+                for (size_t i = 0; i < count; i++, dst += dst_stride)
+                {
+                    *reinterpret_cast<Eigen::Vector3d *>(dst) = Eigen::Vector3d::Zero();
+                }
+            }
+
+            void EncodeColorColumn(const char *src, size_t src_stride,
+                                   char *dst, size_t dst_stride, size_t count)
+            {
+                for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                {
+                    auto rgb = ColorToUint8(*reinterpret_cast<const Eigen::Vector3d *>(src));
+                    std::uint8_t bgra[4] = {rgb(2), rgb(1), rgb(0), 0};
+                    memcpy(dst, bgra, 4);
+                }
+            }
+
+            template <typename Dst>
+            PCDColumnConverter SelectColumnDecoder(const char type, const int size)
+            {
+                if (type == 'I')
+                {
+                    switch (size)
+                    {
+                    case 1:
+                        return ConvertColumn<std::int8_t, Dst>;
+                    case 2:
+                        return ConvertColumn<std::int16_t, Dst>;
+                    case 4:
+                        return ConvertColumn<std::int32_t, Dst>;
+                    }
+                }
+                else if (type == 'U')
+                {
+                    switch (size)
+                    {
+                    case 1:
+                        return ConvertColumn<std::uint8_t, Dst>;
+                    case 2:
+                        return ConvertColumn<std::uint16_t, Dst>;
+                    case 4:
+                        return ConvertColumn<std::uint32_t, Dst>;
+                    }
+                }
+                else if (type == 'F')
+                {
+                    switch (size)
+                    {
+                    case 4:
+                        return ConvertColumn<float, Dst>;
+                    case 8:
+                        return ConvertColumn<double, Dst>;
+                    }
+                }
+                return ZeroColumn<Dst>;
+            }
+
+            template <typename Src>
+            PCDColumnConverter SelectColumnEncoder(const char type, const int size)
+            {
+                if (type == 'I')
+                {
+                    switch (size)
+                    {
+                    case 1:
+                        return ConvertColumn<Src, std::int8_t>;
+                    case 2:
+                        return ConvertColumn<Src, std::int16_t>;
+                    case 4:
+                        return ConvertColumn<Src, std::int32_t>;
+                    }
+                }
+                else if (type == 'U')
+                {
+                    switch (size)
+                    {
+                    case 1:
+                        return ConvertColumn<Src, std::uint8_t>;
+                    case 2:
+                        return ConvertColumn<Src, std::uint16_t>;
+                    case 4:
+                        return ConvertColumn<Src, std::uint32_t>;
+                    }
+                }
+                else if (type == 'F')
+                {
+                    switch (size)
+                    {
+                    case 4:
+                        return ConvertColumn<Src, float>;
+                    case 8:
+                        return ConvertColumn<Src, double>;
+                    }
+                }
+                return NULL;
+            }
+
+            long StrToNumber(const char *token, long) { return std::strtol(token, NULL, 0); }
+
+            unsigned long StrToNumber(const char *token, unsigned long)
+            {
+                return std::strtoul(token, NULL, 0);
+            }
+
+            float StrToNumber(const char *token, float) { return std::strtof(token, NULL); }
+
+            double StrToNumber(const char *token, double) { return std::strtod(token, NULL); }
+
+            /// Parses the token [\p begin, \p end) as strtol/strtoul (base 0) or
+            /// strtof/strtod would. std::from_chars handles the common decimal
+            /// forms; leading '+', hex and octal integers, out-of-range values and
+            /// trailing garbage go through the C library.
+            template <typename T>
+            T ParseNumber(const char *begin, const char *end)
+            {
+                T value;
+                const char *digits = begin + (*begin == '-');
+                bool prefixed = std::is_integral<T>::value && end - digits > 1 && digits[0] == '0';
+                if (*begin != '+' && !prefixed)
+                {
+                    auto result = std::from_chars(begin, end, value);
+                    if (result.ec == std::errc() && result.ptr == end)
+                    {
+                        return value;
+                    }
+                }
+                return StrToNumber(std::string(begin, end).c_str(), value);
+            }
+
+            template <typename Dst>
+            void ParseSignedToken(const char *begin, const char *end, char *dst)
+            {
+                Dst value = (Dst)ParseNumber<long>(begin, end);
+                memcpy(dst, &value, sizeof(value));
+            }
+
+            template <typename Dst>
+            void ParseUnsignedToken(const char *begin, const char *end, char *dst)
+            {
+                Dst value = (Dst)ParseNumber<unsigned long>(begin, end);
+                memcpy(dst, &value, sizeof(value));
+            }
+
+            template <typename Dst>
+            void ParseFloatToken(const char *begin, const char *end, char *dst)
+            {
+                Dst value = (Dst)ParseNumber<double>(begin, end);
+                memcpy(dst, &value, sizeof(value));
+            }
+
+            template <typename Dst>
+            void ParseZeroToken(const char *, const char *, char *dst)
+            {
+                const Dst zero = Dst(0);
+                memcpy(dst, &zero, sizeof(zero));
+            }
+
+            template <typename Word>
+            Word ParseColorWord(const char *begin, const char *end);
+
+            template <>
+            std::int32_t ParseColorWord<std::int32_t>(const char *begin, const char *end)
+            {
+                return ParseNumber<long>(begin, end);
+            }
+
+            template <>
+            std::uint32_t ParseColorWord<std::uint32_t>(const char *begin, const char *end)
+            {
+                return ParseNumber<unsigned long>(begin, end);
+            }
+
+            template <>
+            float ParseColorWord<float>(const char *begin, const char *end)
+            {
+                return ParseNumber<float>(begin, end);
+            }
+
+            template <typename Word>
+            void ParseColorToken(const char *begin, const char *end, char *dst)
+            {
+                std::uint8_t data[4];
+                Word value = ParseColorWord<Word>(begin, end);
+                memcpy(data, &value, 4);
+                *reinterpret_cast<Eigen::Vector3d *>(dst) =
+                    ColorToDouble(data[2], data[1], data[0]);
+            }
+
+            template <typename Word>
+            void ParsePackedColorToken(const char *begin, const char *end, char *dst)
+            {
+                Word value = ParseColorWord<Word>(begin, end);
+                memcpy(dst, &value, 4);
+            }
+
+            void ParseZeroColorToken(const char *, const char *, char *dst)
+            {
+                *reinterpret_cast<Eigen::Vector3d *>(dst) = Eigen::Vector3d::Zero();
+            }
+
+            template <typename Dst>
+            PCDTokenDecoder SelectTokenDecoder(const char type, const int)
+            {
+                if (type == 'I')
+                {
+                    return ParseSignedToken<Dst>;
+                }
+                else if (type == 'U')
+                {
+                    return ParseUnsignedToken<Dst>;
+                }
+                else if (type == 'F')
+                {
+                    return ParseFloatToken<Dst>;
+                }
+                return ParseZeroToken<Dst>;
+            }
+
+            template <typename Src, typename Dst>
+            void DequantizeColumn(const char *src, size_t src_stride,
+                                  char *dst, size_t dst_stride, size_t count,
+                                  double scale, double bias)
+            {
+                if (src_stride == sizeof(Src) && dst_stride == sizeof(Dst))
+                {
+                    // contiguous stripes into SoA columns, left to the vectorizer
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        Src value;
+                        memcpy(&value, src + i * sizeof(Src), sizeof(value));
+                        Dst converted = (Dst)(value * scale + bias);
+                        memcpy(dst + i * sizeof(Dst), &converted, sizeof(converted));
+                    }
+                    return;
+                }
+                for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                {
+                    Src value;
+                    memcpy(&value, src, sizeof(value));
+                    Dst converted = (Dst)(value * scale + bias);
+                    memcpy(dst, &converted, sizeof(converted));
+                }
+            }
+
+            /// Rounds (value - bias) / scale to the nearest \p Dst, saturating.
+            template <typename Dst>
+            Dst QuantizeValue(double value, double scale, double bias)
+            {
+                double q = std::nearbyint((value - bias) / scale);
+                if (!(q >= (double)std::numeric_limits<Dst>::lowest()))
+                {
+                    return std::numeric_limits<Dst>::lowest();
+                }
+                if (q > (double)std::numeric_limits<Dst>::max())
+                {
+                    return std::numeric_limits<Dst>::max();
+                }
+                return (Dst)q;
+            }
+
+            template <typename Src, typename Dst>
+            void QuantizeColumn(const char *src, size_t src_stride,
+                                char *dst, size_t dst_stride, size_t count,
+                                double scale, double bias)
+            {
+                for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                {
+                    Src value;
+                    memcpy(&value, src, sizeof(value));
+                    Dst converted = QuantizeValue<Dst>(value, scale, bias);
+                    memcpy(dst, &converted, sizeof(converted));
+                }
+            }
+
+            /// Picks the quantized converters of \p Slot values for a field of
+            /// \p type and \p size. Returns `false` if the field is not an integer.
+            template <typename Slot>
+            bool SelectScaledConverters(const char type, const int size,
+                                        PCDScaledConverter &dequantize,
+                                        PCDScaledConverter &quantize)
+            {
+                if (type == 'I')
+                {
+                    switch (size)
+                    {
+                    case 1:
+                        dequantize = DequantizeColumn<std::int8_t, Slot>;
+                        quantize = QuantizeColumn<Slot, std::int8_t>;
+                        return true;
+                    case 2:
+                        dequantize = DequantizeColumn<std::int16_t, Slot>;
+                        quantize = QuantizeColumn<Slot, std::int16_t>;
+                        return true;
+                    case 4:
+                        dequantize = DequantizeColumn<std::int32_t, Slot>;
+                        quantize = QuantizeColumn<Slot, std::int32_t>;
+                        return true;
+                    }
+                }
+                else if (type == 'U')
+                {
+                    switch (size)
+                    {
+                    case 1:
+                        dequantize = DequantizeColumn<std::uint8_t, Slot>;
+                        quantize = QuantizeColumn<Slot, std::uint8_t>;
+                        return true;
+                    case 2:
+                        dequantize = DequantizeColumn<std::uint16_t, Slot>;
+                        quantize = QuantizeColumn<Slot, std::uint16_t>;
+                        return true;
+                    case 4:
+                        dequantize = DequantizeColumn<std::uint32_t, Slot>;
+                        quantize = QuantizeColumn<Slot, std::uint32_t>;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /// Makes \p codec dequantize its field, unless the field is a color or
+            /// not an integer.
+            void SelectQuantization(const PCLPointField &field,
+                                    const PCDQuantization &quantization,
+                                    PCDFieldCodec &codec)
+            {
+                if (codec.slot == PCD_SLOT_RGB ||
+                    !SelectScaledConverters<float>(field.type, field.size,
+                                                   codec.dequantize[PCD_SLOT_FLOAT32],
+                                                   codec.quantize[PCD_SLOT_FLOAT32]) ||
+                    !SelectScaledConverters<double>(field.type, field.size,
+                                                    codec.dequantize[PCD_SLOT_FLOAT64],
+                                                    codec.quantize[PCD_SLOT_FLOAT64]))
+                {
+                    return;
+                }
+                codec.scale = quantization.scale;
+                codec.bias = quantization.offset;
+            }
+
+            void SelectScalarConverters(const char type, const int size,
+                                        PCDFieldCodec &codec)
+            {
+                codec.scale = 0;
+                codec.bias = 0;
+                for (int i = 0; i < PCD_SLOT_TYPE_COUNT; i++)
+                {
+                    codec.decode[i] = NULL;
+                    codec.parse[i] = NULL;
+                    codec.encode[i] = NULL;
+                    codec.dequantize[i] = NULL;
+                    codec.quantize[i] = NULL;
+                }
+                if (codec.slot != PCD_SLOT_RGB)
+                {
+                    codec.decode[PCD_SLOT_FLOAT32] = SelectColumnDecoder<float>(type, size);
+                    codec.decode[PCD_SLOT_FLOAT64] = SelectColumnDecoder<double>(type, size);
+                    codec.parse[PCD_SLOT_FLOAT32] = SelectTokenDecoder<float>(type, size);
+                    codec.parse[PCD_SLOT_FLOAT64] = SelectTokenDecoder<double>(type, size);
+                    codec.encode[PCD_SLOT_FLOAT32] = SelectColumnEncoder<float>(type, size);
+                    codec.encode[PCD_SLOT_FLOAT64] = SelectColumnEncoder<double>(type, size);
+                    return;
+                }
+                if (size != 4)
+                {
+                    codec.decode[PCD_SLOT_COLOR3D] = ZeroColorColumn;
+                    codec.decode[PCD_SLOT_PACKED_RGB] = ZeroColumn<std::uint32_t>;
+                    codec.parse[PCD_SLOT_COLOR3D] = ParseZeroColorToken;
+                    codec.parse[PCD_SLOT_PACKED_RGB] = ParseZeroToken<std::uint32_t>;
+                    return;
+                }
+                // Colors are always a packed word, whatever the declared type.
+                codec.decode[PCD_SLOT_COLOR3D] = DecodeColorColumn;
+                codec.decode[PCD_SLOT_PACKED_RGB] = ConvertColumn<std::uint32_t, std::uint32_t>;
+                codec.encode[PCD_SLOT_COLOR3D] = EncodeColorColumn;
+                codec.encode[PCD_SLOT_PACKED_RGB] = ConvertColumn<std::uint32_t, std::uint32_t>;
+                if (type == 'I')
+                {
+                    codec.parse[PCD_SLOT_COLOR3D] = ParseColorToken<std::int32_t>;
+                    codec.parse[PCD_SLOT_PACKED_RGB] = ParsePackedColorToken<std::int32_t>;
+                }
+                else if (type == 'U')
+                {
+                    codec.parse[PCD_SLOT_COLOR3D] = ParseColorToken<std::uint32_t>;
+                    codec.parse[PCD_SLOT_PACKED_RGB] = ParsePackedColorToken<std::uint32_t>;
+                }
+                else if (type == 'F')
+                {
+                    codec.parse[PCD_SLOT_COLOR3D] = ParseColorToken<float>;
+                    codec.parse[PCD_SLOT_PACKED_RGB] = ParsePackedColorToken<float>;
+                }
+                else
+                {
+                    codec.parse[PCD_SLOT_COLOR3D] = ParseZeroColorToken;
+                    codec.parse[PCD_SLOT_PACKED_RGB] = ParseZeroToken<std::uint32_t>;
+                }
+            }
+
+            /// Resolves the converters of \p codec for a field of \p type and \p size.
+            void SelectFieldConverters(const char type, const int size,
+                                       PCDFieldCodec &codec)
+            {
+                SelectScalarConverters(type, size, codec);
+                SelectSimdConverters(type, size, codec);
+            }
+
+            /// Whitespace separating the tokens of an ASCII line.
+            bool IsTokenDelimiter(char c)
+            {
+                return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+            }
+
+            /// Stores the bounds of the first \p count tokens of [\p begin, \p end)
+            /// in \p tokens. Returns `false` if the line holds fewer tokens.
+            bool TokenizeLine(const char *begin, const char *end, int count,
+                              std::vector<const char *> &tokens)
+            {
+                tokens.resize(2 * (size_t)count);
+                const char *ptr = begin;
+                for (int i = 0; i < count; i++)
+                {
+                    while (ptr < end && IsTokenDelimiter(*ptr))
+                    {
+                        ptr++;
+                    }
+                    if (ptr == end)
+                    {
+                        return false;
+                    }
+                    tokens[2 * i] = ptr;
+                    while (ptr < end && !IsTokenDelimiter(*ptr))
+                    {
+                        ptr++;
+                    }
+                    tokens[2 * i + 1] = ptr;
+                }
+                return true;
+            }
+
+            /// Decodes the lines of [\p data, \p end) into points \p idx onwards,
+            /// stopping at point \p limit. With NULL \p bindings the valid lines
+            /// are only counted. Returns the number of points found.
+            size_t DecodePCDLines(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  const char *data,
+                                  const char *end,
+                                  size_t idx,
+                                  size_t limit,
+                                  std::vector<const char *> &tokens)
+            {
+                size_t found = 0;
+                while (data < end && idx + found < limit)
+                {
+                    const char *eol = static_cast<const char *>(memchr(data, '\n', end - data));
+                    const char *line_end = eol == NULL ? end : eol;
+                    bool valid = bindings == NULL
+                                     ? TokenizeLine(data, line_end, header.elementnum, tokens)
+                                     : DecodePCDLine(header, bindings, data, line_end,
+                                                     idx + found, tokens);
+                    if (valid)
+                    {
+                        found++;
+                    }
+                    data = eol == NULL ? end : eol + 1;
+                }
+                return found;
+            }
+
+            /// Returns the line starting at \p ptr (without its terminator) and advances
+            /// \p ptr past it.
+            std::string ReadLine(const char *&ptr, const char *end)
+            {
+                const char *eol = static_cast<const char *>(memchr(ptr, '\n', end - ptr));
+                const char *line_end = eol == NULL ? end : eol;
+                std::string line(ptr, line_end);
+                ptr = eol == NULL ? end : eol + 1;
+                return line;
+            }
+
+            /// Returns `true` if the block index of \p header describes a stream of
+            /// \p compressed_size bytes decoding to \p uncompressed_size bytes.
+            bool CheckBlockIndex(const PCDHeader &header,
+                                 std::uint32_t compressed_size,
+                                 std::uint32_t uncompressed_size)
+            {
+                size_t num_blocks = header.lzf_blocks.size();
+                // Every block but the last is full and the last one is not empty.
+                // Divides, since the block size comes from the file and the product
+                // may wrap.
+                if (num_blocks < 2 || header.lzf_block_size == 0 || uncompressed_size == 0 ||
+                    header.lzf_block_size > (uncompressed_size - 1) / (num_blocks - 1))
+                {
+                    return false;
+                }
+                size_t total = 0;
+                for (auto size : header.lzf_blocks)
+                {
+                    if (size > compressed_size - total)
+                    {
+                        return false;
+                    }
+                    total += size;
+                }
+                return total == compressed_size;
+            }
+
+            /// Parses the decimal token \p token into \p value. Returns `false`
+            /// unless the whole token is a number no larger than \p max.
+            bool ParseIndexNumber(const std::string &token, std::uint64_t max,
+                                  std::uint64_t &value)
+            {
+                const char *end = token.data() + token.size();
+                auto result = std::from_chars(token.data(), end, value);
+                return result.ec == std::errc() && result.ptr == end && value <= max;
+            }
+
+            /// Header names of the PCDFilter values.
+            const char *const kPCDFilterNames[] = {"none", "shuffle", "delta+shuffle",
+                                                   "xor+shuffle"};
+
+            /// Byte-shuffles the \p count elements of \p in into \p out, so that
+            /// byte b of element i lands at out[b * count + i]. Delta and XOR
+            /// filters first replace every element by its difference or XOR with
+            /// the previous one, which turns slowly varying values into runs of
+            /// zero bytes.
+            template <typename Word, PCDFilter Filter>
+            void FilterElements(const char *in, char *out, size_t count)
+            {
+                Word prev = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    Word value;
+                    memcpy(&value, in + i * sizeof(Word), sizeof(Word));
+                    Word word = value;
+                    if (Filter == PCD_FILTER_DELTA_SHUFFLE)
+                    {
+                        word = (Word)(value - prev);
+                    }
+                    else if (Filter == PCD_FILTER_XOR_SHUFFLE)
+                    {
+                        word = (Word)(value ^ prev);
+                    }
+                    prev = value;
+                    for (size_t b = 0; b < sizeof(Word); b++)
+                    {
+                        out[b * count + i] = (char)(word >> (8 * b));
+                    }
+                }
+            }
+
+            template <typename Word, PCDFilter Filter>
+            void UnfilterElements(const char *in, char *out, size_t count)
+            {
+                Word prev = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    Word word = 0;
+                    for (size_t b = 0; b < sizeof(Word); b++)
+                    {
+                        word |= (Word)((Word)(unsigned char)in[b * count + i] << (8 * b));
+                    }
+                    Word value = word;
+                    if (Filter == PCD_FILTER_DELTA_SHUFFLE)
+                    {
+                        value = (Word)(word + prev);
+                    }
+                    else if (Filter == PCD_FILTER_XOR_SHUFFLE)
+                    {
+                        value = (Word)(word ^ prev);
+                    }
+                    prev = value;
+                    memcpy(out + i * sizeof(Word), &value, sizeof(Word));
+                }
+            }
+
+            typedef void (*PCDElementFilter)(const char *in, char *out, size_t count);
+
+            template <typename Word>
+            PCDElementFilter SelectElementFilter(PCDFilter filter, bool inverse)
+            {
+                switch (filter)
+                {
+                case PCD_FILTER_SHUFFLE:
+                    return inverse ? UnfilterElements<Word, PCD_FILTER_SHUFFLE>
+                                   : FilterElements<Word, PCD_FILTER_SHUFFLE>;
+                case PCD_FILTER_DELTA_SHUFFLE:
+                    return inverse ? UnfilterElements<Word, PCD_FILTER_DELTA_SHUFFLE>
+                                   : FilterElements<Word, PCD_FILTER_DELTA_SHUFFLE>;
+                case PCD_FILTER_XOR_SHUFFLE:
+                    return inverse ? UnfilterElements<Word, PCD_FILTER_XOR_SHUFFLE>
+                                   : FilterElements<Word, PCD_FILTER_XOR_SHUFFLE>;
+                default:
+                    return NULL;
+                }
+            }
+
+            /// Filters or unfilters every planned stripe of \p stripes into \p out.
+            /// Elements of other sizes than 1, 2, 4 and 8 bytes are copied as is.
+            void TransformPCDStripes(const PCDHeader &header,
+                                     const char *stripes,
+                                     char *out,
+                                     bool inverse,
+                                     int num_threads)
+            {
+                utility::ThreadPool::Global().ParallelFor(
+                    header.plan.size(),
+                    [&](size_t i)
+                    {
+                        const auto &codec = header.plan[i];
+                        size_t bytes = (size_t)codec.stripe_stride * header.points;
+                        const char *in = stripes + codec.stripe_offset;
+                        PCDElementFilter transform = NULL;
+                        switch (codec.size)
+                        {
+                        case 1:
+                            transform = SelectElementFilter<std::uint8_t>(header.filter, inverse);
+                            break;
+                        case 2:
+                            transform = SelectElementFilter<std::uint16_t>(header.filter, inverse);
+                            break;
+                        case 4:
+                            transform = SelectElementFilter<std::uint32_t>(header.filter, inverse);
+                            break;
+                        case 8:
+                            transform = SelectElementFilter<std::uint64_t>(header.filter, inverse);
+                            break;
+                        }
+                        if (transform == NULL)
+                        {
+                            memcpy(out + codec.stripe_offset, in, bytes);
+                        }
+                        else
+                        {
+                            transform(in, out + codec.stripe_offset, bytes / codec.size);
+                        }
+                    },
+                    (size_t)std::max(num_threads, 0));
+            }
+
+            /// \brief Calls \p body(codec, begin, count) over [0, \p points) for every
+            /// planned field, in chunks of PCD_BINARY_CHUNK_POINTS on the global pool.
+            ///
+            /// Chunks of one field are adjacent tasks, so concurrent calls write
+            /// distinct ranges and share cache lines only at chunk ends. Inputs of
+            /// less than one chunk run serially, one call per field.
+            template <typename Body>
+            void ForEachStripeChunk(const PCDHeader &header,
+                                    size_t points,
+                                    int num_threads,
+                                    const Body &body)
+            {
+                auto &pool = utility::ThreadPool::Global();
+                if (points < PCD_BINARY_CHUNK_POINTS || pool.NumThreads() < 2 || num_threads == 1)
+                {
+                    for (const auto &codec : header.plan)
+                    {
+                        body(codec, (size_t)0, points);
+                    }
+                    return;
+                }
+                size_t num_chunks = (points + PCD_BINARY_CHUNK_POINTS - 1) / PCD_BINARY_CHUNK_POINTS;
+                pool.ParallelFor(
+                    header.plan.size() * num_chunks,
+                    [&](size_t i)
+                    {
+                        size_t begin = i % num_chunks * PCD_BINARY_CHUNK_POINTS;
+                        body(header.plan[i / num_chunks], begin,
+                             std::min((size_t)PCD_BINARY_CHUNK_POINTS, points - begin));
+                    },
+                    (size_t)std::max(num_threads, 0));
+            }
+
+            /// Formats one binary element of \p type and \p size as an ASCII token
+            /// at \p out and returns the end of the token. Floating point values use
+            /// the shortest text that reads back to the same value. Integers wider
+            /// than 4 bytes are formatted from their first 4 bytes.
+            char *FormatBinaryElement(char *out, const char *data_ptr,
+                                      const char type, const int size)
+            {
+                char *out_end = out + PCD_ASCII_TOKEN_BYTES;
+                if (type == 'F' && size == 4)
+                {
+                    float value;
+                    memcpy(&value, data_ptr, sizeof(value));
+                    return std::to_chars(out, out_end, value).ptr;
+                }
+                else if (type == 'F' && size == 8)
+                {
+                    double value;
+                    memcpy(&value, data_ptr, sizeof(value));
+                    return std::to_chars(out, out_end, value).ptr;
+                }
+                else if (type == 'U' || type == 'I')
+                {
+                    std::int64_t value = 0;
+                    if (type == 'U' && size == 1)
+                    {
+                        std::uint8_t word;
+                        memcpy(&word, data_ptr, sizeof(word));
+                        value = word;
+                    }
+                    else if (type == 'U' && size == 2)
+                    {
+                        std::uint16_t word;
+                        memcpy(&word, data_ptr, sizeof(word));
+                        value = word;
+                    }
+                    else if (type == 'U')
+                    {
+                        std::uint32_t word;
+                        memcpy(&word, data_ptr, sizeof(word));
+                        value = word;
+                    }
+                    else if (size == 1)
+                    {
+                        std::int8_t word;
+                        memcpy(&word, data_ptr, sizeof(word));
+                        value = word;
+                    }
+                    else if (size == 2)
+                    {
+                        std::int16_t word;
+                        memcpy(&word, data_ptr, sizeof(word));
+                        value = word;
+                    }
+                    else
+                    {
+                        std::int32_t word;
+                        memcpy(&word, data_ptr, sizeof(word));
+                        value = word;
+                    }
+                    return std::to_chars(out, out_end, value).ptr;
+                }
+                return out;
+            }
+
+            /// Formats \p count binary records as ASCII lines at \p out and returns
+            /// the end of the text. \p out must hold PCD_ASCII_TOKEN_BYTES + 1
+            /// bytes per field and record.
+            char *FormatPCDRecords(const PCDHeader &header, const char *records,
+                                   size_t count, char *out)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    const char *record = records + i * header.pointsize;
+                    for (size_t f = 0; f < header.fields.size(); f++)
+                    {
+                        const auto &field = header.fields[f];
+                        if (f > 0)
+                        {
+                            *out++ = ' ';
+                        }
+                        out = FormatBinaryElement(out, record + field.offset, field.type,
+                                                  field.size);
+                    }
+                    *out++ = '\n';
+                }
+                return out;
+            }
+        } // unnamed namespace
+
+        namespace internal
+        {
+            bool CheckHeader(PCDHeader &header)
+            {
+                if (header.points <= 0 || header.pointsize <= 0)
+                {
+                    utility::LogError("[CheckHeader] PCD has no data.\n");
+                    return false;
+                }
+                if (header.fields.size() == 0 || header.pointsize <= 0)
+                {
+                    utility::LogError("[CheckHeader] PCD has no fields.\n");
+                    return false;
+                }
+                header.has_points = false;
+                header.has_intensitys = false;
+                header.has_normals = false;
+                header.has_colors = false;
+                bool has_x = false;
+                bool has_y = false;
+                bool has_z = false;
+                bool has_normal_x = false;
+                bool has_normal_y = false;
+                bool has_normal_z = false;
+                bool has_rgb = false;
+                bool has_rgba = false;
+                bool has_intensity = false;
+                std::vector<int> slots(header.fields.size(), -1);
+                for (size_t i = 0; i < header.fields.size(); i++)
+                {
+                    const auto &field = header.fields[i];
+                    if (field.name == "x")
+                    {
+                        has_x = true;
+                        slots[i] = PCD_SLOT_X;
+                    }
+                    else if (field.name == "y")
+                    {
+                        has_y = true;
+                        slots[i] = PCD_SLOT_Y;
+                    }
+                    else if (field.name == "z")
+                    {
+                        has_z = true;
+                        slots[i] = PCD_SLOT_Z;
+                    }
+                    else if (field.name == "intensity")
+                    {
+                        has_intensity = true;
+                        slots[i] = PCD_SLOT_INTENSITY;
+                    }
+                    else if (field.name == "normal_x")
+                    {
+                        has_normal_x = true;
+                        slots[i] = PCD_SLOT_NORMAL_X;
+                    }
+                    else if (field.name == "normal_y")
+                    {
+                        has_normal_y = true;
+                        slots[i] = PCD_SLOT_NORMAL_Y;
+                    }
+                    else if (field.name == "normal_z")
+                    {
+                        has_normal_z = true;
+                        slots[i] = PCD_SLOT_NORMAL_Z;
+                    }
+                    else if (field.name == "rgb")
+                    {
+                        has_rgb = true;
+                        slots[i] = PCD_SLOT_RGB;
+                    }
+                    else if (field.name == "rgba")
+                    {
+                        has_rgba = true;
+                        slots[i] = PCD_SLOT_RGB;
+                    }
+                }
+                header.has_points = (has_x && has_y && has_z);
+                header.has_intensitys = has_intensity;
+                header.has_normals = (has_normal_x && has_normal_y && has_normal_z);
+                header.has_colors = (has_rgb || has_rgba);
+                if (!header.has_points)
+                {
+                    utility::LogError("[CheckHeader] Fields for point data are not complete.\n");
+                    return false;
+                }
+                // Resolve every field once so that decoding never looks at names again.
+                header.plan.clear();
+                for (size_t i = 0; i < header.fields.size(); i++)
+                {
+                    const auto &field = header.fields[i];
+                    if (slots[i] < 0 ||
+                        (slots[i] >= PCD_SLOT_NORMAL_X && slots[i] <= PCD_SLOT_NORMAL_Z &&
+                         !header.has_normals))
+                    {
+                        continue;
+                    }
+                    PCDFieldCodec codec;
+                    codec.slot = PCDFieldSlot(slots[i]);
+                    codec.offset = field.offset;
+                    codec.stripe_offset = (size_t)field.offset * header.points;
+                    codec.stripe_stride = field.size * field.count;
+                    codec.size = field.size;
+                    codec.count_offset = field.count_offset;
+                    SelectFieldConverters(field.type, field.size, codec);
+                    for (const auto &quantization : header.quantization)
+                    {
+                        if (quantization.name == field.name)
+                        {
+                            SelectQuantization(field, quantization, codec);
+                        }
+                    }
+                    header.plan.push_back(codec);
+                }
+                return true;
+            }
+
+            void SelectPCDFields(PCDHeader &header, unsigned int fields)
+            {
+                header.has_intensitys &= (fields & ReadPointCloudOption::Intensity) != 0;
+                header.has_normals &= (fields & ReadPointCloudOption::Normals) != 0;
+                header.has_colors &= (fields & ReadPointCloudOption::Colors) != 0;
+                auto skipped = [&header](const PCDFieldCodec &codec)
+                {
+                    switch (codec.slot)
+                    {
+                    case PCD_SLOT_INTENSITY:
+                        return !header.has_intensitys;
+                    case PCD_SLOT_NORMAL_X:
+                    case PCD_SLOT_NORMAL_Y:
+                    case PCD_SLOT_NORMAL_Z:
+                        return !header.has_normals;
+                    case PCD_SLOT_RGB:
+                        return !header.has_colors;
+                    default:
+                        return false;
+                    }
+                };
+                header.plan.erase(std::remove_if(header.plan.begin(), header.plan.end(), skipped),
+                                  header.plan.end());
+            }
+
+            bool ReadPCDHeader(const char *&data, const char *end, PCDHeader &header)
+            {
+                size_t specified_channel_count = 0;
+
+                while (data < end)
+                {
+                    std::string line = ReadLine(data, end);
+                    if (line == "")
+                    {
+                        continue;
+                    }
+                    std::vector<std::string> st = SplitString(line, "\t\r\n ");
+                    std::stringstream sstream(line);
+                    sstream.imbue(std::locale::classic());
+                    std::string line_type;
+                    sstream >> line_type;
+                    if (line_type.substr(0, 1) == "#")
+                    {
+                        // The block index is written as a comment that other readers skip.
+                        if (st.size() >= 4 && st[0] == "#" && st[1] == "PCDIO_LZF_BLOCKS")
+                        {
+                            // An index that does not parse is ignored, the data is
+                            // then decoded serially.
+                            std::uint64_t block_size = 0, num_blocks = 0, size = 0;
+                            bool valid = ParseIndexNumber(st[2], UINT_MAX, block_size) &&
+                                         ParseIndexNumber(st[3], UINT32_MAX, num_blocks) &&
+                                         num_blocks == st.size() - 4;
+                            header.lzf_blocks.clear();
+                            for (size_t i = 4; valid && i < st.size(); i++)
+                            {
+                                valid = ParseIndexNumber(st[i], UINT32_MAX, size);
+                                header.lzf_blocks.push_back((std::uint32_t)size);
+                            }
+                            if (!valid)
+                            {
+                                utility::LogWarning("[ReadPCDHeader] Ignoring a malformed "
+                                                    "PCDIO_LZF_BLOCKS line.\n");
+                                header.lzf_blocks.clear();
+                                block_size = 0;
+                            }
+                            header.lzf_block_size = (size_t)block_size;
+                        }
+                        // Filtered stripes cannot be decoded without the filter, so
+                        // an unknown one fails the read instead of yielding garbage.
+                        else if (st.size() >= 3 && st[0] == "#" && st[1] == "PCDIO_FILTER")
+                        {
+                            auto name = std::find(std::begin(kPCDFilterNames),
+                                                  std::end(kPCDFilterNames), st[2]);
+                            if (name == std::end(kPCDFilterNames))
+                            {
+                                utility::LogError("[ReadPCDHeader] Unknown stripe filter %s.\n",
+                                                  st[2].c_str());
+                                return false;
+                            }
+                            header.filter = PCDFilter(name - std::begin(kPCDFilterNames));
+                        }
+                        else if (st.size() >= 5 && st[0] == "#" && st[1] == "PCDIO_QUANTIZE")
+                        {
+                            PCDQuantization quantization;
+                            quantization.name = st[2];
+                            quantization.scale = std::strtod(st[3].c_str(), NULL);
+                            quantization.offset = std::strtod(st[4].c_str(), NULL);
+                            if (!std::isfinite(quantization.scale) || quantization.scale == 0 ||
+                                !std::isfinite(quantization.offset))
+                            {
+                                utility::LogError("[ReadPCDHeader] Bad quantization of field %s.\n",
+                                                  st[2].c_str());
+                                return false;
+                            }
+                            header.quantization.push_back(quantization);
+                        }
+                        else if (st.size() >= 3 && st[0] == "#" && st[1] == "PCDIO_CODEC")
+                        {
+                            header.codec = FindBlockCodec(st[2]);
+                            if (header.codec == NULL)
+                            {
+                                utility::LogError("[ReadPCDHeader] Unknown compression codec %s.\n",
+                                                  st[2].c_str());
+                                return false;
+                            }
+                        }
+                    }
+                    else if (line_type.substr(0, 7) == "VERSION")
+                    {
+                        if (st.size() >= 2)
+                        {
+                            header.version = st[1];
+                        }
+                    }
+                    else if (line_type.substr(0, 6) == "FIELDS" ||
+                             line_type.substr(0, 7) == "COLUMNS")
+                    {
+                        specified_channel_count = st.size() - 1;
+                        if (specified_channel_count == 0)
+                        {
+                            utility::LogError("[ReadPCDHeader] Bad PCD file format.\n");
+                            return false;
+                        }
+                        header.fields.resize(specified_channel_count);
+                        int count_offset = 0, offset = 0;
+                        for (size_t i = 0; i < specified_channel_count;
+                             i++, count_offset += 1, offset += 4)
+                        {
+                            header.fields[i].name = st[i + 1];
+                            header.fields[i].size = 4;
+                            header.fields[i].type = 'F';
+                            header.fields[i].count = 1;
+                            header.fields[i].count_offset = count_offset;
+                            header.fields[i].offset = offset;
+                        }
+                        header.elementnum = count_offset;
+                        header.pointsize = offset;
+                    }
+                    else if (line_type.substr(0, 4) == "SIZE")
+                    {
+                        if (specified_channel_count != st.size() - 1)
+                        {
+                            utility::LogError("[ReadPCDHeader] Bad PCD file format.\n");
+                            return false;
+                        }
+                        int offset = 0, col_type = 0;
+                        for (size_t i = 0; i < specified_channel_count;
+                             i++, offset += col_type)
+                        {
+                            sstream >> col_type;
+                            header.fields[i].size = col_type;
+                            header.fields[i].offset = offset;
+                        }
+                        header.pointsize = offset;
+                    }
+                    else if (line_type.substr(0, 4) == "TYPE")
+                    {
+                        if (specified_channel_count != st.size() - 1)
+                        {
+                            utility::LogError("[ReadPCDHeader] Bad PCD file format.\n");
+                            return false;
+                        }
+                        for (size_t i = 0; i < specified_channel_count; i++)
+                        {
+                            header.fields[i].type = st[i + 1].c_str()[0];
+                        }
+                    }
+                    else if (line_type.substr(0, 5) == "COUNT")
+                    {
+                        if (specified_channel_count != st.size() - 1)
+                        {
+                            utility::LogError("[ReadPCDHeader] Bad PCD file format.\n");
+                            return false;
+                        }
+                        int count_offset = 0, offset = 0, col_count = 0;
+                        for (size_t i = 0; i < specified_channel_count; i++)
+                        {
+                            sstream >> col_count;
+                            header.fields[i].count = col_count;
+                            header.fields[i].count_offset = count_offset;
+                            header.fields[i].offset = offset;
+                            count_offset += col_count;
+                            offset += col_count * header.fields[i].size;
+                        }
+                        header.elementnum = count_offset;
+                        header.pointsize = offset;
+                    }
+                    else if (line_type.substr(0, 5) == "WIDTH")
+                    {
+                        sstream >> header.width;
+                    }
+                    else if (line_type.substr(0, 6) == "HEIGHT")
+                    {
+                        sstream >> header.height;
+                        header.points = header.width * header.height;
+                    }
+                    else if (line_type.substr(0, 9) == "VIEWPOINT")
+                    {
+                        if (st.size() >= 2)
+                        {
+                            header.viewpoint = st[1];
+                        }
+                    }
+                    else if (line_type.substr(0, 6) == "POINTS")
+                    {
+                        sstream >> header.points;
+                    }
+                    else if (line_type.substr(0, 4) == "DATA")
+                    {
+                        header.datatype = PCD_DATA_ASCII;
+                        if (st.size() >= 2)
+                        {
+                            if (st[1].substr(0, 17) == "binary_compressed")
+                            {
+                                header.datatype = PCD_DATA_BINARY_COMPRESSED;
+                            }
+                            else if (st[1].substr(0, 6) == "binary")
+                            {
+                                header.datatype = PCD_DATA_BINARY;
+                            }
+                        }
+                        break;
+                    }
+                }
+                if (!CheckHeader(header))
+                {
+                    return false;
+                }
+                return true;
+            }
+
+            const char *FindPCDHeaderEnd(const char *data, const char *end)
+            {
+                while (data < end)
+                {
+                    const char *eol = static_cast<const char *>(memchr(data, '\n', end - data));
+                    if (eol == NULL)
+                    {
+                        return NULL;
+                    }
+                    while (data < eol && (*data == ' ' || *data == '\t'))
+                    {
+                        data++;
+                    }
+                    if (eol - data >= 4 && memcmp(data, "DATA", 4) == 0)
+                    {
+                        return eol + 1;
+                    }
+                    data = eol + 1;
+                }
+                return NULL;
+            }
+
+            bool DecompressBlocks(const PCDHeader &header,
+                                  const char *in_data,
+                                  std::uint32_t compressed_size,
+                                  char *out_data,
+                                  std::uint32_t uncompressed_size)
+            {
+                if (!CheckBlockIndex(header, compressed_size, uncompressed_size))
+                {
+                    return header.codec->Decompress(in_data, compressed_size, out_data,
+                                                    uncompressed_size);
+                }
+                size_t num_blocks = header.lzf_blocks.size();
+                std::vector<size_t> input_offsets(num_blocks, 0);
+                for (size_t i = 1; i < num_blocks; i++)
+                {
+                    input_offsets[i] = input_offsets[i - 1] + header.lzf_blocks[i - 1];
+                }
+                std::atomic<bool> failed(false);
+                utility::ThreadPool::Global().ParallelFor(
+                    num_blocks,
+                    [&](size_t i)
+                    {
+                        size_t output_offset = i * header.lzf_block_size;
+                        size_t output_size = i + 1 < num_blocks
+                                                 ? header.lzf_block_size
+                                                 : uncompressed_size - output_offset;
+                        // Blocks holding no planned stripe are never decoded.
+                        bool needed = false;
+                        for (const auto &codec : header.plan)
+                        {
+                            size_t stripe_end = codec.stripe_offset +
+                                                codec.stripe_stride * (size_t)header.points;
+                            needed |= codec.stripe_offset < output_offset + output_size &&
+                                      stripe_end > output_offset;
+                        }
+                        if (!needed)
+                        {
+                            return;
+                        }
+                        if (!header.codec->Decompress(in_data + input_offsets[i],
+                                                      header.lzf_blocks[i],
+                                                      out_data + output_offset, output_size))
+                        {
+                            failed = true;
+                        }
+                    });
+                return !failed;
+            }
+
+            void FilterPCDStripes(const PCDHeader &header,
+                                  const char *stripes,
+                                  char *out,
+                                  int num_threads)
+            {
+                TransformPCDStripes(header, stripes, out, false, num_threads);
+            }
+
+            void UnfilterPCDStripes(const PCDHeader &header,
+                                    const char *stripes,
+                                    char *out)
+            {
+                TransformPCDStripes(header, stripes, out, true, 0);
+            }
+
+            bool QuantizePCDHeader(PCDHeader &header,
+                                   const PCDSlotBinding *bindings,
+                                   double step)
+            {
+                header.quantization.clear();
+                size_t points = (size_t)header.points;
+                for (auto &field : header.fields)
+                {
+                    int slot = field.name == "x"   ? PCD_SLOT_X
+                               : field.name == "y" ? PCD_SLOT_Y
+                               : field.name == "z" ? PCD_SLOT_Z
+                                                   : -1;
+                    if (slot < 0 || field.count != 1)
+                    {
+                        continue;
+                    }
+                    const auto &binding = bindings[slot];
+                    double min = INFINITY, max = -INFINITY;
+                    bool finite = true;
+                    const char *src = binding.base;
+                    for (size_t i = 0; i < points; i++, src += binding.stride)
+                    {
+                        double value;
+                        if (binding.type == PCD_SLOT_FLOAT32)
+                        {
+                            float single;
+                            memcpy(&single, src, sizeof(single));
+                            value = single;
+                        }
+                        else
+                        {
+                            memcpy(&value, src, sizeof(value));
+                        }
+                        finite &= std::isfinite(value);
+                        min = std::min(min, value);
+                        max = std::max(max, value);
+                    }
+                    PCDQuantization quantization;
+                    quantization.name = field.name;
+                    quantization.scale = step;
+                    quantization.offset = step * std::nearbyint((min + max) / 2 / step);
+                    double low = std::nearbyint((min - quantization.offset) / step);
+                    double high = std::nearbyint((max - quantization.offset) / step);
+                    if (!finite || !std::isfinite(quantization.offset))
+                    {
+                        utility::LogWarning("[QuantizePCDHeader] Field %s has non-finite values "
+                                            "and is stored as floats.\n",
+                                            field.name.c_str());
+                        continue;
+                    }
+                    if (low >= INT16_MIN && high <= INT16_MAX)
+                    {
+                        field.size = 2;
+                    }
+                    else if (low >= INT32_MIN && high <= INT32_MAX)
+                    {
+                        field.size = 4;
+                    }
+                    else
+                    {
+                        utility::LogWarning("[QuantizePCDHeader] Field %s spans too many steps "
+                                            "and is stored as floats.\n",
+                                            field.name.c_str());
+                        continue;
+                    }
+                    field.type = 'I';
+                    header.quantization.push_back(quantization);
+                }
+                int offset = 0;
+                for (auto &field : header.fields)
+                {
+                    field.offset = offset;
+                    offset += field.size * field.count;
+                }
+                header.pointsize = offset;
+                return CheckHeader(header);
+            }
+
+            void BindSlots(const geometry::PointCloud &pointcloud,
+                           PCDSlotBinding *bindings)
+            {
+                char *points = (char *)pointcloud.points_.data();
+                char *normals = (char *)pointcloud.normals_.data();
+                for (int i = 0; i < 3; i++)
+                {
+                    bindings[PCD_SLOT_X + i] = {points + i * sizeof(double),
+                                                sizeof(Eigen::Vector3d), PCD_SLOT_FLOAT64};
+                    bindings[PCD_SLOT_NORMAL_X + i] = {normals + i * sizeof(double),
+                                                       sizeof(Eigen::Vector3d),
+                                                       PCD_SLOT_FLOAT64};
+                }
+                bindings[PCD_SLOT_INTENSITY] = {(char *)pointcloud.intensitys_.data(),
+                                                sizeof(float), PCD_SLOT_FLOAT32};
+                bindings[PCD_SLOT_RGB] = {(char *)pointcloud.colors_.data(),
+                                          sizeof(Eigen::Vector3d), PCD_SLOT_COLOR3D};
+            }
+
+            void PrepareSlotBindings(const PCDHeader &header,
+                                     size_t points,
+                                     geometry::PointCloud &pointcloud,
+                                     PCDSlotBinding *bindings)
+            {
+                pointcloud.points_.resize(points);
+                pointcloud.intensitys_.resize(header.has_intensitys ? points : 0);
+                pointcloud.normals_.resize(header.has_normals ? points : 0);
+                pointcloud.colors_.resize(header.has_colors ? points : 0);
+                BindSlots(pointcloud, bindings);
+            }
+
+            void DecodePCDRecords(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  const char *records,
+                                  size_t begin,
+                                  size_t count)
+            {
+                // Decode field by field over cache-sized blocks of records.
+                for (size_t done = 0; done < count; done += PCD_RECORD_BLOCK_POINTS)
+                {
+                    size_t block = std::min((size_t)PCD_RECORD_BLOCK_POINTS, count - done);
+                    const char *block_records = records + done * header.pointsize;
+                    for (const auto &codec : header.plan)
+                    {
+                        const auto &binding = bindings[codec.slot];
+                        DecodeFieldColumn(codec, binding.type, block_records + codec.offset,
+                                          header.pointsize,
+                                          binding.base + (begin + done) * binding.stride,
+                                          binding.stride, block);
+                    }
+                }
+            }
+
+            void DecodePCDStripes(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  const char *stripes,
+                                  size_t src_begin,
+                                  size_t dst_begin,
+                                  size_t count)
+            {
+                for (const auto &codec : header.plan)
+                {
+                    const auto &binding = bindings[codec.slot];
+                    DecodeFieldColumn(
+                        codec, binding.type,
+                        stripes + codec.stripe_offset + src_begin * codec.stripe_stride,
+                        codec.stripe_stride, binding.base + dst_begin * binding.stride,
+                        binding.stride, count);
+                }
+            }
+
+            bool DecodePCDLine(const PCDHeader &header,
+                               const PCDSlotBinding *bindings,
+                               const char *begin,
+                               const char *end,
+                               size_t idx,
+                               std::vector<const char *> &tokens)
+            {
+                if (!TokenizeLine(begin, end, header.elementnum, tokens))
+                {
+                    return false;
+                }
+                for (const auto &codec : header.plan)
+                {
+                    const auto &binding = bindings[codec.slot];
+                    const char *token = tokens[2 * codec.count_offset];
+                    const char *token_end = tokens[2 * codec.count_offset + 1];
+                    char *dst = binding.base + idx * binding.stride;
+                    if (codec.scale == 0)
+                    {
+                        codec.parse[binding.type](token, token_end, dst);
+                        continue;
+                    }
+                    double value;
+                    codec.parse[PCD_SLOT_FLOAT64](token, token_end, (char *)&value);
+                    value = value * codec.scale + codec.bias;
+                    if (binding.type == PCD_SLOT_FLOAT32)
+                    {
+                        float converted = (float)value;
+                        memcpy(dst, &converted, sizeof(converted));
+                    }
+                    else
+                    {
+                        memcpy(dst, &value, sizeof(value));
+                    }
+                }
+                return true;
+            }
+
+            bool ReadPCDData(const char *data,
+                             const char *end,
+                             const PCDHeader &header,
+                             const PCDSlotBinding *bindings,
+                             PCDScratch &scratch,
+                             IOStats *stats)
+            {
+                // The header should have been checked
+                if (!header.has_points)
+                {
+                    utility::LogError("[ReadPCDData] Fields for point data are not complete.\n");
+                    return false;
+                }
+
+                if (header.datatype == PCD_DATA_ASCII)
+                {
+                    if (stats != NULL)
+                    {
+                        stats->data_bytes = end - data;
+                    }
+                    ScopedTimer timer(stats, &IOStats::conversion_seconds);
+                    // Large inputs are split into line-aligned chunks. The points of
+                    // a chunk start after the valid lines of the chunks before it,
+                    // which a first pass counts without parsing any value.
+                    auto &pool = utility::ThreadPool::Global();
+                    size_t num_chunks = std::min((size_t)(end - data) / PCD_ASCII_CHUNK_BYTES,
+                                                 pool.NumThreads() * 4);
+                    if (num_chunks < 2 || pool.NumThreads() < 2)
+                    {
+                        std::vector<const char *> tokens;
+                        DecodePCDLines(header, bindings, data, end, 0, header.points, tokens);
+                        return true;
+                    }
+                    std::vector<const char *> bounds(num_chunks + 1, end);
+                    bounds[0] = data;
+                    for (size_t i = 1; i < num_chunks; i++)
+                    {
+                        const char *split = std::max(bounds[i - 1],
+                                                     data + (end - data) / num_chunks * i);
+                        const char *eol = static_cast<const char *>(
+                            memchr(split, '\n', end - split));
+                        bounds[i] = eol == NULL ? end : eol + 1;
+                    }
+                    std::vector<size_t> first(num_chunks + 1, 0);
+                    pool.ParallelFor(
+                        num_chunks,
+                        [&](size_t i)
+                        {
+                            std::vector<const char *> tokens;
+                            first[i + 1] = DecodePCDLines(header, NULL, bounds[i], bounds[i + 1],
+                                                          0, header.points, tokens);
+                        });
+                    for (size_t i = 0; i < num_chunks; i++)
+                    {
+                        first[i + 1] += first[i];
+                    }
+                    pool.ParallelFor(
+                        num_chunks,
+                        [&](size_t i)
+                        {
+                            std::vector<const char *> tokens;
+                            DecodePCDLines(header, bindings, bounds[i], bounds[i + 1],
+                                           first[i], header.points, tokens);
+                        });
+                }
+                else if (header.datatype == PCD_DATA_BINARY)
+                {
+                    if ((size_t)(end - data) < (size_t)header.points * header.pointsize)
+                    {
+                        utility::LogError("[ReadPCDData] Failed to read data record.\n");
+                        return false;
+                    }
+                    if (stats != NULL)
+                    {
+                        stats->data_bytes = (size_t)header.points * header.pointsize;
+                    }
+                    ScopedTimer timer(stats, &IOStats::conversion_seconds);
+                    // Every chunk decodes its own range of records into a disjoint
+                    // range of the destination.
+                    auto &pool = utility::ThreadPool::Global();
+                    size_t points = (size_t)header.points;
+                    size_t num_chunks = std::min(points / PCD_BINARY_CHUNK_POINTS,
+                                                 pool.NumThreads() * 4);
+                    if (num_chunks < 2 || pool.NumThreads() < 2)
+                    {
+                        DecodePCDRecords(header, bindings, data, 0, points);
+                        return true;
+                    }
+                    size_t chunk_points = (points / num_chunks + PCD_RECORD_BLOCK_POINTS - 1) /
+                                          PCD_RECORD_BLOCK_POINTS * PCD_RECORD_BLOCK_POINTS;
+                    pool.ParallelFor(
+                        (points + chunk_points - 1) / chunk_points,
+                        [&](size_t i)
+                        {
+                            size_t begin = i * chunk_points;
+                            size_t count = std::min(chunk_points, points - begin);
+                            DecodePCDRecords(header, bindings,
+                                             data + begin * header.pointsize, begin, count);
+                        });
+                }
+                else if (header.datatype == PCD_DATA_BINARY_COMPRESSED)
+                {
+                    std::uint32_t compressed_size;
+                    std::uint32_t uncompressed_size;
+                    if ((size_t)(end - data) < sizeof(compressed_size) + sizeof(uncompressed_size))
+                    {
+                        utility::LogError("[ReadPCDData] Failed to read data record.\n");
+                        return false;
+                    }
+                    memcpy(&compressed_size, data, sizeof(compressed_size));
+                    data += sizeof(compressed_size);
+                    memcpy(&uncompressed_size, data, sizeof(uncompressed_size));
+                    data += sizeof(uncompressed_size);
+                    utility::LogDebug("PCD data with %d compressed size, and %d uncompressed size.\n",
+                                      compressed_size, uncompressed_size);
+                    if ((size_t)(end - data) < compressed_size)
+                    {
+                        utility::LogError("[ReadPCDData] Failed to read data record.\n");
+                        return false;
+                    }
+                    if ((size_t)uncompressed_size < (size_t)header.points * header.pointsize)
+                    {
+                        utility::LogError("[ReadPCDData] Uncompressed size does not match the header.\n");
+                        return false;
+                    }
+                    if (stats != NULL)
+                    {
+                        stats->data_bytes = uncompressed_size;
+                        stats->compression_ratio =
+                            compressed_size > 0 ? (double)uncompressed_size / compressed_size : 1.0;
+                    }
+                    // Decompress straight from the mapped pages.
+                    char *stripes = scratch.stripes.Reserve(uncompressed_size);
+                    {
+                        ScopedTimer timer(stats, &IOStats::compression_seconds);
+                        if (!DecompressBlocks(header, data, compressed_size, stripes,
+                                              uncompressed_size))
+                        {
+                            utility::LogError("[ReadPCDData] Uncompression failed.\n");
+                            return false;
+                        }
+                        if (header.filter != PCD_FILTER_NONE)
+                        {
+                            char *unfiltered = scratch.filtered.Reserve(uncompressed_size);
+                            UnfilterPCDStripes(header, stripes, unfiltered);
+                            stripes = unfiltered;
+                        }
+                    }
+                    ScopedTimer timer(stats, &IOStats::conversion_seconds);
+                    ForEachStripeChunk(
+                        header, (size_t)header.points, 0,
+                        [&](const PCDFieldCodec &codec, size_t begin, size_t count)
+                        {
+                            const auto &binding = bindings[codec.slot];
+                            DecodeFieldColumn(
+                                codec, binding.type,
+                                stripes + codec.stripe_offset + begin * codec.stripe_stride,
+                                codec.stripe_stride, binding.base + begin * binding.stride,
+                                binding.stride, count);
+                        });
+                }
+                return true;
+            }
+
+            bool GenerateHeader(size_t points,
+                                const bool has_intensitys,
+                                const bool has_normals,
+                                const bool has_colors,
+                                const bool write_ascii,
+                                const bool compressed,
+                                PCDHeader &header)
+            {
+                if (points == 0)
+                {
+                    return false;
+                }
+                header.version = "0.7";
+                header.width = (int)points;
+                header.height = 1;
+                header.points = header.width;
+                header.fields.clear();
+                std::vector<std::string> names = {"x", "y", "z"};
+                if (has_normals)
+                {
+                    names.push_back("normal_x");
+                    names.push_back("normal_y");
+                    names.push_back("normal_z");
+                }
+                if (has_colors)
+                {
+                    names.push_back("rgb");
+                }
+                if (has_intensitys)
+                {
+                    names.push_back("intensity");
+                }
+                PCLPointField field;
+                field.type = 'F';
+                field.size = 4;
+                field.count = 1;
+                field.count_offset = 0;
+                field.offset = 0;
+                for (const auto &name : names)
+                {
+                    field.name = name;
+                    header.fields.push_back(field);
+                    field.count_offset += field.count;
+                    field.offset += field.size * field.count;
+                }
+                header.elementnum = field.count_offset;
+                header.pointsize = field.offset;
+                if (write_ascii)
+                {
+                    header.datatype = PCD_DATA_ASCII;
+                }
+                else
+                {
+                    if (compressed)
+                    {
+                        header.datatype = PCD_DATA_BINARY_COMPRESSED;
+                    }
+                    else
+                    {
+                        header.datatype = PCD_DATA_BINARY;
+                    }
+                }
+                return CheckHeader(header);
+            }
+
+            bool GenerateHeader(const geometry::PointCloud &pointcloud,
+                                const bool write_ascii,
+                                const bool compressed,
+                                PCDHeader &header)
+            {
+                if (!pointcloud.HasPoints())
+                {
+                    return false;
+                }
+                return GenerateHeader(pointcloud.points_.size(), pointcloud.HasIntensitys(),
+                                      pointcloud.HasNormals(), pointcloud.HasColors(),
+                                      write_ascii, compressed, header);
+            }
+
+            bool WritePCDHeader(FILE *file, const PCDHeader &header, bool fixed_width)
+            {
+                fprintf(file, "# .PCD v%s - Point Cloud Data file format\n",
+                        header.version.c_str());
+                fprintf(file, "VERSION %s\n", header.version.c_str());
+                fprintf(file, "FIELDS");
+                for (const auto &field : header.fields)
+                {
+                    fprintf(file, " %s", field.name.c_str());
+                }
+                fprintf(file, "\n");
+                fprintf(file, "SIZE");
+                for (const auto &field : header.fields)
+                {
+                    fprintf(file, " %d", field.size);
+                }
+                fprintf(file, "\n");
+                fprintf(file, "TYPE");
+                for (const auto &field : header.fields)
+                {
+                    fprintf(file, " %c", field.type);
+                }
+                fprintf(file, "\n");
+                fprintf(file, "COUNT");
+                for (const auto &field : header.fields)
+                {
+                    fprintf(file, " %d", field.count);
+                }
+                fprintf(file, "\n");
+                if (fixed_width)
+                {
+                    fprintf(file, "WIDTH %-10d\n", header.width);
+                }
+                else
+                {
+                    fprintf(file, "WIDTH %d\n", header.width);
+                }
+                fprintf(file, "HEIGHT %d\n", header.height);
+                fprintf(file, "VIEWPOINT 0 0 0 1 0 0 0\n");
+                if (fixed_width)
+                {
+                    fprintf(file, "POINTS %-10d\n", header.points);
+                }
+                else
+                {
+                    fprintf(file, "POINTS %d\n", header.points);
+                }
+                if (header.datatype == PCD_DATA_BINARY_COMPRESSED && header.lzf_blocks.size() > 1)
+                {
+                    fprintf(file, "# PCDIO_LZF_BLOCKS %zu %zu", header.lzf_block_size,
+                            header.lzf_blocks.size());
+                    for (auto size : header.lzf_blocks)
+                    {
+                        fprintf(file, " %u", size);
+                    }
+                    fprintf(file, "\n");
+                }
+                for (const auto &quantization : header.quantization)
+                {
+                    fprintf(file, "# PCDIO_QUANTIZE %s %.17g %.17g\n", quantization.name.c_str(),
+                            quantization.scale, quantization.offset);
+                }
+                if (header.datatype == PCD_DATA_BINARY_COMPRESSED &&
+                    header.codec != &LZFBlockCodec())
+                {
+                    fprintf(file, "# PCDIO_CODEC %s\n", header.codec->Name());
+                }
+                if (header.datatype == PCD_DATA_BINARY_COMPRESSED &&
+                    header.filter != PCD_FILTER_NONE)
+                {
+                    fprintf(file, "# PCDIO_FILTER %s\n", kPCDFilterNames[header.filter]);
+                }
+
+                switch (header.datatype)
+                {
+                case PCD_DATA_BINARY:
+                    fprintf(file, "DATA binary\n");
+                    break;
+                case PCD_DATA_BINARY_COMPRESSED:
+                    fprintf(file, "DATA binary_compressed\n");
+                    break;
+                case PCD_DATA_ASCII:
+                default:
+                    fprintf(file, "DATA ascii\n");
+                    break;
+                }
+                return true;
+            }
+
+            std::uint32_t CompressBlocks(const char *in_data,
+                                         size_t in_len,
+                                         size_t block_size,
+                                         int num_threads,
+                                         const BlockCodec &codec,
+                                         int level,
+                                         std::vector<LZFBlock> &blocks,
+                                         PCDScratchBuffer &output)
+            {
+                size_t num_blocks = std::max<size_t>(1, (in_len + block_size - 1) / block_size);
+                // Never leave a tail too short to compress, merge it instead.
+                if (num_blocks > 1 && in_len - (num_blocks - 1) * block_size < 16)
+                {
+                    num_blocks--;
+                }
+                blocks.resize(num_blocks);
+                size_t output_size = 0;
+                for (size_t i = 0; i < num_blocks; i++)
+                {
+                    blocks[i].input_offset = i * block_size;
+                    blocks[i].input_size = i + 1 < num_blocks ? block_size
+                                                              : in_len - i * block_size;
+                    blocks[i].output_offset = output_size;
+                    output_size += codec.CompressBound(blocks[i].input_size);
+                }
+                char *out_data = output.Reserve(output_size);
+                utility::ThreadPool::Global().ParallelFor(
+                    num_blocks,
+                    [&](size_t i)
+                    {
+                        LZFBlock &block = blocks[i];
+                        size_t size = codec.Compress(
+                            in_data + block.input_offset, block.input_size,
+                            out_data + block.output_offset,
+                            codec.CompressBound(block.input_size), level);
+                        block.compressed_size = size > UINT32_MAX ? 0 : (std::uint32_t)size;
+                    },
+                    (size_t)std::max(num_threads, 0));
+                size_t total = 0;
+                for (const auto &block : blocks)
+                {
+                    if (block.compressed_size == 0)
+                    {
+                        return 0;
+                    }
+                    total += block.compressed_size;
+                }
+                return total > UINT32_MAX ? 0 : (std::uint32_t)total;
+            }
+
+            void EncodePCDRecords(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  size_t begin,
+                                  size_t count,
+                                  char *records)
+            {
+                for (const auto &codec : header.plan)
+                {
+                    const auto &binding = bindings[codec.slot];
+                    EncodeFieldColumn(codec, binding.type, binding.base + begin * binding.stride,
+                                      binding.stride, records + codec.offset,
+                                      header.pointsize, count);
+                }
+            }
+
+            bool CompressPCDData(PCDHeader &header,
+                                 const PCDSlotBinding *bindings,
+                                 const WritePointCloudOption &params,
+                                 PCDScratch &scratch)
+            {
+                // Fields are stored one stripe after another.
+                size_t points = (size_t)header.points;
+                size_t buffer_size = (size_t)header.pointsize * points;
+                if (buffer_size > UINT32_MAX)
+                {
+                    utility::LogError("[CompressPCDData] Data is too large for binary_compressed.\n");
+                    return false;
+                }
+                char *stripes = scratch.stripes.Reserve(buffer_size);
+                {
+                    ScopedTimer timer(params.stats, &IOStats::conversion_seconds);
+                    ForEachStripeChunk(
+                        header, points, params.num_threads,
+                        [&](const PCDFieldCodec &codec, size_t begin, size_t count)
+                        {
+                            const auto &binding = bindings[codec.slot];
+                            EncodeFieldColumn(
+                                codec, binding.type, binding.base + begin * binding.stride,
+                                binding.stride,
+                                stripes + codec.stripe_offset + begin * codec.stripe_stride,
+                                codec.stripe_stride, count);
+                        });
+                }
+                PCDCompressedData &compressed = scratch.compressed;
+                compressed.uncompressed_size = (std::uint32_t)buffer_size;
+                header.codec = FindBlockCodec(params.compression_codec);
+                if (header.codec == NULL)
+                {
+                    utility::LogError("[CompressPCDData] Unknown compression codec %s.\n",
+                                      params.compression_codec.c_str());
+                    return false;
+                }
+                header.filter = PCDFilter(params.compression_filter);
+                if (header.filter != PCD_FILTER_NONE)
+                {
+                    ScopedTimer timer(params.stats, &IOStats::compression_seconds);
+                    char *filtered = scratch.filtered.Reserve(buffer_size);
+                    FilterPCDStripes(header, stripes, filtered, params.num_threads);
+                    stripes = filtered;
+                }
+                header.lzf_block_size = std::max<size_t>(params.compression_block_size, 1024);
+                {
+                    ScopedTimer timer(params.stats, &IOStats::compression_seconds);
+                    compressed.compressed_size = CompressBlocks(
+                        stripes, buffer_size, header.lzf_block_size, params.num_threads,
+                        *header.codec, (int)params.compression_level, compressed.blocks, compressed.output);
+                }
+                if (compressed.compressed_size == 0)
+                {
+                    utility::LogError("[CompressPCDData] Failed to compress data.\n");
+                    return false;
+                }
+                utility::LogInfo("[CompressPCDData] %d bytes data compressed into %d bytes.\n",
+                                 compressed.uncompressed_size, compressed.compressed_size);
+                header.lzf_blocks.clear();
+                for (const auto &block : compressed.blocks)
+                {
+                    header.lzf_blocks.push_back(block.compressed_size);
+                }
+                return true;
+            }
+
+            bool WritePCDRecords(FILE *file,
+                                 const PCDHeader &header,
+                                 const PCDSlotBinding *bindings,
+                                 size_t points,
+                                 PCDScratch &scratch,
+                                 int num_threads,
+                                 IOStats *stats)
+            {
+                size_t records_size = (size_t)PCD_RECORD_BLOCK_POINTS * header.pointsize;
+                if (scratch.records.empty())
+                {
+                    scratch.records.resize(1);
+                }
+                if (header.datatype == PCD_DATA_BINARY)
+                {
+                    char *records = scratch.records[0].Reserve(records_size);
+                    for (size_t begin = 0; begin < points; begin += PCD_RECORD_BLOCK_POINTS)
+                    {
+                        size_t count = std::min((size_t)PCD_RECORD_BLOCK_POINTS, points - begin);
+                        {
+                            ScopedTimer timer(stats, &IOStats::conversion_seconds);
+                            EncodePCDRecords(header, bindings, begin, count, records);
+                        }
+                        ScopedTimer timer(stats, &IOStats::io_seconds);
+                        if (fwrite(records, header.pointsize, count, file) != count)
+                        {
+                            utility::LogError("[WritePCDRecords] Failed to write data record.\n");
+                            return false;
+                        }
+                    }
+                    if (stats != NULL)
+                    {
+                        stats->data_bytes += points * header.pointsize;
+                    }
+                    return true;
+                }
+                // ASCII blocks are formatted in rounds, one block per thread into its
+                // own buffer, and written in order.
+                auto &pool = utility::ThreadPool::Global();
+                size_t num_blocks = (points + PCD_RECORD_BLOCK_POINTS - 1) / PCD_RECORD_BLOCK_POINTS;
+                size_t num_slots = std::min(num_threads > 0 ? (size_t)num_threads
+                                                            : pool.NumThreads(),
+                                            num_blocks);
+                size_t text_size = (size_t)PCD_RECORD_BLOCK_POINTS * header.fields.size() *
+                                   (PCD_ASCII_TOKEN_BYTES + 1);
+                if (scratch.records.size() < num_slots)
+                {
+                    scratch.records.resize(num_slots);
+                }
+                if (scratch.texts.size() < num_slots)
+                {
+                    scratch.texts.resize(num_slots);
+                }
+                std::vector<char *> text_ends(num_slots);
+                for (size_t i = 0; i < num_slots; i++)
+                {
+                    scratch.records[i].Reserve(records_size);
+                    scratch.texts[i].Reserve(text_size);
+                }
+                for (size_t round = 0; round < num_blocks; round += num_slots)
+                {
+                    size_t round_blocks = std::min(num_slots, num_blocks - round);
+                    {
+                        ScopedTimer timer(stats, &IOStats::conversion_seconds);
+                        pool.ParallelFor(
+                            round_blocks,
+                            [&](size_t i)
+                            {
+                                size_t begin = (round + i) * PCD_RECORD_BLOCK_POINTS;
+                                size_t count = std::min((size_t)PCD_RECORD_BLOCK_POINTS,
+                                                        points - begin);
+                                char *records = scratch.records[i].Data();
+                                EncodePCDRecords(header, bindings, begin, count, records);
+                                text_ends[i] = FormatPCDRecords(header, records, count,
+                                                                scratch.texts[i].Data());
+                            },
+                            num_slots);
+                    }
+                    ScopedTimer timer(stats, &IOStats::io_seconds);
+                    for (size_t i = 0; i < round_blocks; i++)
+                    {
+                        const char *text = scratch.texts[i].Data();
+                        size_t size = text_ends[i] - text;
+                        if (fwrite(text, 1, size, file) != size)
+                        {
+                            utility::LogError("[WritePCDRecords] Failed to write data record.\n");
+                            return false;
+                        }
+                        if (stats != NULL)
+                        {
+                            stats->data_bytes += size;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            bool WritePCDData(FILE *file,
+                              const PCDHeader &header,
+                              const PCDSlotBinding *bindings,
+                              const WritePointCloudOption &params,
+                              PCDScratch &scratch)
+            {
+                if (header.datatype == PCD_DATA_ASCII || header.datatype == PCD_DATA_BINARY)
+                {
+                    return WritePCDRecords(file, header, bindings, (size_t)header.points,
+                                           scratch, params.num_threads, params.stats);
+                }
+                if (header.datatype == PCD_DATA_BINARY_COMPRESSED)
+                {
+                    const PCDCompressedData &compressed = scratch.compressed;
+                    if (params.stats != NULL)
+                    {
+                        params.stats->data_bytes = compressed.uncompressed_size;
+                        params.stats->compression_ratio =
+                            (double)compressed.uncompressed_size / compressed.compressed_size;
+                    }
+                    ScopedTimer timer(params.stats, &IOStats::io_seconds);
+                    fwrite(&compressed.compressed_size, sizeof(compressed.compressed_size), 1, file);
+                    fwrite(&compressed.uncompressed_size, sizeof(compressed.uncompressed_size), 1,
+                           file);
+                    for (const auto &block : compressed.blocks)
+                    {
+                        if (fwrite(compressed.output.Data() + block.output_offset, 1,
+                                   block.compressed_size, file) != block.compressed_size)
+                        {
+                            utility::LogError("[WritePCDData] Failed to write data record.\n");
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+        } // namespace internal
+    } // namespace io
+} // namespace pcd
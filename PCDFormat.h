@@ -0,0 +1,543 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BlockCodec.h"
+#include "PointCloud.h"
+#include "PointCloudIO.h"
+#include "PointCloudSoA.h"
+
+// Number of binary records converted per field pass.
+#define PCD_RECORD_BLOCK_POINTS 4096
+
+namespace pcd
+{
+    namespace io
+    {
+        /// Building blocks of the PCD reader and writers, shared by the whole
+        /// file API and the streaming classes. Not part of the public interface.
+        namespace internal
+        {
+            /// Destination of a decoded field inside the point cloud.
+            enum PCDFieldSlot
+            {
+                PCD_SLOT_X = 0,
+                PCD_SLOT_Y,
+                PCD_SLOT_Z,
+                PCD_SLOT_NORMAL_X,
+                PCD_SLOT_NORMAL_Y,
+                PCD_SLOT_NORMAL_Z,
+                PCD_SLOT_INTENSITY,
+                PCD_SLOT_RGB,
+                PCD_SLOT_COUNT
+            };
+
+            /// In-memory representation of a slot.
+            enum PCDSlotType
+            {
+                PCD_SLOT_FLOAT32 = 0,
+                PCD_SLOT_FLOAT64,
+                // Eigen::Vector3d color in [0, 1]
+                PCD_SLOT_COLOR3D,
+                // packed 0x00RRGGBB word, as stored in the rgb field
+                PCD_SLOT_PACKED_RGB,
+                PCD_SLOT_TYPE_COUNT
+            };
+
+            /// Converts \p count elements placed \p src_stride bytes apart into
+            /// elements placed \p dst_stride bytes apart.
+            typedef void (*PCDColumnConverter)(const char *src, size_t src_stride,
+                                               char *dst, size_t dst_stride,
+                                               size_t count);
+            /// Converts \p count quantized elements q into scale * q + bias, or
+            /// floating point elements back into quantized ones.
+            typedef void (*PCDScaledConverter)(const char *src, size_t src_stride,
+                                               char *dst, size_t dst_stride,
+                                               size_t count, double scale, double bias);
+            /// Converts the ASCII token [begin, end) into a destination value.
+            typedef void (*PCDTokenDecoder)(const char *begin, const char *end, char *dst);
+
+            /// \struct PCDFieldCodec
+            /// \brief One entry of the field plan: where a field lives in the file
+            /// data, which slot it maps to, and the converters resolved for its type
+            /// and size for every slot representation.
+            struct PCDFieldCodec
+            {
+                PCDFieldSlot slot;
+                // byte offset inside a binary record
+                int offset;
+                // byte offset of the stripe inside the binary_compressed buffer
+                size_t stripe_offset;
+                // byte distance between two elements inside a stripe
+                int stripe_stride;
+                // bytes of one element of the field
+                int size;
+                // token index inside an ASCII line
+                int count_offset;
+                PCDColumnConverter decode[PCD_SLOT_TYPE_COUNT];
+                PCDTokenDecoder parse[PCD_SLOT_TYPE_COUNT];
+                PCDColumnConverter encode[PCD_SLOT_TYPE_COUNT];
+                // quantized fields hold (value - bias) / scale, scale is 0 for
+                // the others
+                double scale;
+                double bias;
+                PCDScaledConverter dequantize[PCD_SLOT_TYPE_COUNT];
+                PCDScaledConverter quantize[PCD_SLOT_TYPE_COUNT];
+            };
+
+            /// Decodes \p count elements of the field of \p codec into a slot of
+            /// \p type, dequantizing quantized fields.
+            inline void DecodeFieldColumn(const PCDFieldCodec &codec, PCDSlotType type,
+                                          const char *src, size_t src_stride,
+                                          char *dst, size_t dst_stride, size_t count)
+            {
+                if (codec.scale != 0)
+                {
+                    codec.dequantize[type](src, src_stride, dst, dst_stride, count,
+                                           codec.scale, codec.bias);
+                }
+                else
+                {
+                    codec.decode[type](src, src_stride, dst, dst_stride, count);
+                }
+            }
+
+            /// Inverse of DecodeFieldColumn().
+            inline void EncodeFieldColumn(const PCDFieldCodec &codec, PCDSlotType type,
+                                          const char *src, size_t src_stride,
+                                          char *dst, size_t dst_stride, size_t count)
+            {
+                if (codec.scale != 0)
+                {
+                    codec.quantize[type](src, src_stride, dst, dst_stride, count,
+                                         codec.scale, codec.bias);
+                }
+                else
+                {
+                    codec.encode[type](src, src_stride, dst, dst_stride, count);
+                }
+            }
+
+            /// \struct PCDSlotBinding
+            /// \brief Storage of one PCDFieldSlot in a concrete point cloud.
+            struct PCDSlotBinding
+            {
+                char *base;
+                size_t stride;
+                PCDSlotType type;
+            };
+
+            enum PCDDataType
+            {
+                PCD_DATA_ASCII = 0,
+                PCD_DATA_BINARY = 1,
+                PCD_DATA_BINARY_COMPRESSED = 2
+            };
+
+            /// Reversible transforms applied to every stripe of binary_compressed
+            /// data before LZF, matching WritePointCloudOption::CompressionFilter.
+            enum PCDFilter
+            {
+                PCD_FILTER_NONE = 0,
+                PCD_FILTER_SHUFFLE = 1,
+                PCD_FILTER_DELTA_SHUFFLE = 2,
+                PCD_FILTER_XOR_SHUFFLE = 3
+            };
+
+            struct PCLPointField
+            {
+            public:
+                std::string name;
+                int size;
+                char type;
+                int count;
+                // helper variable
+                int count_offset;
+                int offset;
+            };
+
+            /// \struct PCDQuantization
+            /// \brief Field stored as integers: value = scale * stored + offset.
+            struct PCDQuantization
+            {
+                std::string name;
+                double scale;
+                double offset;
+            };
+
+            struct PCDHeader
+            {
+            public:
+                std::string version;
+                std::vector<PCLPointField> fields;
+                int width;
+                int height;
+                int points;
+                PCDDataType datatype;
+                std::string viewpoint;
+                // helper variables
+                int elementnum;
+                int pointsize;
+                bool has_points;
+                bool has_intensitys;
+                bool has_normals;
+                bool has_colors;
+                // field plan resolved from the fields
+                std::vector<PCDFieldCodec> plan;
+                // LZF block index of binary_compressed data, empty if not recorded
+                size_t lzf_block_size = 0;
+                std::vector<std::uint32_t> lzf_blocks;
+                // filter of the binary_compressed stripes
+                PCDFilter filter = PCD_FILTER_NONE;
+                // codec of the binary_compressed blocks
+                const BlockCodec *codec = &LZFBlockCodec();
+                // quantized fields
+                std::vector<PCDQuantization> quantization;
+            };
+
+            template <typename Scalar>
+            struct PCDSlotTypeOf;
+            template <>
+            struct PCDSlotTypeOf<float>
+            {
+                static const PCDSlotType value = PCD_SLOT_FLOAT32;
+            };
+            template <>
+            struct PCDSlotTypeOf<double>
+            {
+                static const PCDSlotType value = PCD_SLOT_FLOAT64;
+            };
+
+            /// \struct LZFBlock
+            /// \brief One independently compressed piece of a binary_compressed buffer.
+            struct LZFBlock
+            {
+                size_t input_offset;
+                size_t input_size;
+                // offset of the block's scratch space in the output buffer
+                size_t output_offset;
+                std::uint32_t compressed_size;
+            };
+
+            /// \class PCDScratchBuffer
+            /// \brief Byte buffer that only grows, so that reusing it across calls
+            /// stops allocating once it fits the largest request.
+            class PCDScratchBuffer
+            {
+            public:
+                /// Returns at least \p size bytes. The contents are lost when the
+                /// buffer grows.
+                char *Reserve(size_t size)
+                {
+                    if (size > capacity_)
+                    {
+                        // free first, old and new buffer are never held together
+                        data_.reset();
+                        capacity_ = 0;
+                        data_.reset(new char[size]);
+                        capacity_ = size;
+                    }
+                    return data_.get();
+                }
+                char *Data() const { return data_.get(); }
+                size_t Capacity() const { return capacity_; }
+                void Release()
+                {
+                    data_.reset();
+                    capacity_ = 0;
+                }
+
+            private:
+                std::unique_ptr<char[]> data_;
+                size_t capacity_ = 0;
+            };
+
+            /// \struct PCDCompressedData
+            /// \brief binary_compressed payload ready to be written.
+            struct PCDCompressedData
+            {
+                std::uint32_t compressed_size = 0;
+                std::uint32_t uncompressed_size = 0;
+                std::vector<LZFBlock> blocks;
+                PCDScratchBuffer output;
+            };
+
+            /// \struct PCDScratch
+            /// \brief Working buffers of reads and writes, kept between calls by a
+            /// PCDIOContext.
+            struct PCDScratch
+            {
+                // uncompressed stripes
+                PCDScratchBuffer stripes;
+                // stripes after filtering or unfiltering
+                PCDScratchBuffer filtered;
+                // compressed blocks of a write
+                PCDCompressedData compressed;
+                // one block of records and of ascii text per thread
+                std::vector<PCDScratchBuffer> records;
+                std::vector<PCDScratchBuffer> texts;
+            };
+
+            /// \class ScopedTimer
+            /// \brief Adds its lifetime to one duration of an IOStats. Does nothing
+            /// if the stats are NULL.
+            class ScopedTimer
+            {
+            public:
+                ScopedTimer(IOStats *stats, double IOStats::*seconds)
+                    : seconds_(stats != NULL ? &(stats->*seconds) : NULL),
+                      begin_(std::chrono::steady_clock::now()) {}
+                ~ScopedTimer()
+                {
+                    if (seconds_ != NULL)
+                    {
+                        *seconds_ += std::chrono::duration<double>(
+                                         std::chrono::steady_clock::now() - begin_)
+                                         .count();
+                    }
+                }
+                ScopedTimer(const ScopedTimer &) = delete;
+                ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+            private:
+                double *seconds_;
+                std::chrono::steady_clock::time_point begin_;
+            };
+
+            /// Validates \p header and resolves its field plan.
+            bool CheckHeader(PCDHeader &header);
+
+            /// \brief Drops the optional attributes missing from \p fields, a
+            /// combination of ReadPointCloudOption::Field values, from the has_*
+            /// flags and the field plan, so that their data is never decoded.
+            void SelectPCDFields(PCDHeader &header, unsigned int fields);
+
+            /// Parses the header found at \p data in place. On success \p data points
+            /// to the first byte after the DATA line.
+            bool ReadPCDHeader(const char *&data, const char *end, PCDHeader &header);
+
+            /// Returns the first byte after the DATA line of the header at \p data,
+            /// or NULL if [\p data, \p end) does not hold a complete header.
+            const char *FindPCDHeaderEnd(const char *data, const char *end);
+
+            /// \brief Decompresses a binary_compressed stream into \p out_data.
+            ///
+            /// Streams carrying a valid block index are decoded block by block on the
+            /// global thread pool, skipping blocks that hold none of the planned
+            /// stripes; everything else goes through one serial pass.
+            bool DecompressBlocks(const PCDHeader &header,
+                                  const char *in_data,
+                                  std::uint32_t compressed_size,
+                                  char *out_data,
+                                  std::uint32_t uncompressed_size);
+
+            /// \brief Applies the filter of \p header to every planned stripe of the
+            /// uncompressed buffer \p stripes, writing the result at the same
+            /// offsets of \p out.
+            ///
+            /// Stripes are filtered in parallel on the global thread pool, using up
+            /// to \p num_threads threads (0 for all of them).
+            void FilterPCDStripes(const PCDHeader &header,
+                                  const char *stripes,
+                                  char *out,
+                                  int num_threads = 0);
+
+            /// Inverts FilterPCDStripes() for every planned stripe of \p stripes.
+            void UnfilterPCDStripes(const PCDHeader &header,
+                                    const char *stripes,
+                                    char *out);
+
+            /// \brief Stores x, y and z of the points bound to \p bindings as integers
+            /// in steps of \p step.
+            ///
+            /// Each axis gets an offset at the centre of its extent and 16-bit
+            /// integers if they can hold the extent, 32-bit ones otherwise. Axes
+            /// with non-finite values or a too large extent stay floats. Updates
+            /// the fields, quantization and plan of \p header.
+            bool QuantizePCDHeader(PCDHeader &header,
+                                   const PCDSlotBinding *bindings,
+                                   double step);
+
+            /// Binds the storage of \p pointcloud to the field slots.
+            void BindSlots(const geometry::PointCloud &pointcloud,
+                           PCDSlotBinding *bindings);
+
+            /// Sizes \p pointcloud to \p points points with the attributes described
+            /// by \p header and binds its storage to the field slots.
+            void PrepareSlotBindings(const PCDHeader &header,
+                                     size_t points,
+                                     geometry::PointCloud &pointcloud,
+                                     PCDSlotBinding *bindings);
+
+            /// Decodes \p count binary records into points [\p begin, \p begin +
+            /// \p count) of \p bindings.
+            void DecodePCDRecords(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  const char *records,
+                                  size_t begin,
+                                  size_t count);
+
+            /// Decodes points [\p src_begin, \p src_begin + \p count) of the
+            /// uncompressed binary_compressed buffer \p stripes into points starting
+            /// at \p dst_begin of \p bindings.
+            void DecodePCDStripes(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  const char *stripes,
+                                  size_t src_begin,
+                                  size_t dst_begin,
+                                  size_t count);
+
+            /// \brief Decodes the ASCII line [\p begin, \p end) into point \p idx of
+            /// \p bindings. Returns `false` if the line holds too few tokens to be
+            /// a point.
+            ///
+            /// \param tokens Scratch space for token bounds, reused across lines so
+            /// that decoding does not allocate.
+            bool DecodePCDLine(const PCDHeader &header,
+                               const PCDSlotBinding *bindings,
+                               const char *begin,
+                               const char *end,
+                               size_t idx,
+                               std::vector<const char *> &tokens);
+
+            /// Decodes the data section [\p data, \p end) into \p bindings, adding
+            /// to the data size and timings of \p stats when not NULL.
+            bool ReadPCDData(const char *data,
+                             const char *end,
+                             const PCDHeader &header,
+                             const PCDSlotBinding *bindings,
+                             PCDScratch &scratch,
+                             IOStats *stats = NULL);
+
+            /// Describes the fields written for a cloud of \p points points: xyz as
+            /// floats, followed by the optional attributes.
+            bool GenerateHeader(size_t points,
+                                const bool has_intensitys,
+                                const bool has_normals,
+                                const bool has_colors,
+                                const bool write_ascii,
+                                const bool compressed,
+                                PCDHeader &header);
+
+            bool GenerateHeader(const geometry::PointCloud &pointcloud,
+                                const bool write_ascii,
+                                const bool compressed,
+                                PCDHeader &header);
+
+            /// \brief Writes the header of \p header.
+            ///
+            /// \param fixed_width Pads WIDTH and POINTS to ten digits so that a
+            /// later header with other sizes overwrites this one exactly.
+            bool WritePCDHeader(FILE *file, const PCDHeader &header,
+                                bool fixed_width = false);
+
+            /// \brief Compresses \p in_len bytes as consecutive blocks on the global
+            /// thread pool.
+            ///
+            /// Blocks do not reference each other, so for LZF writing their outputs
+            /// back to back yields one valid LZF stream. \p level is one of the
+            /// CODEC_LEVEL_* values. Returns the total compressed size, or 0 on
+            /// failure.
+            std::uint32_t CompressBlocks(const char *in_data,
+                                         size_t in_len,
+                                         size_t block_size,
+                                         int num_threads,
+                                         const BlockCodec &codec,
+                                         int level,
+                                         std::vector<LZFBlock> &blocks,
+                                         PCDScratchBuffer &output);
+
+            /// Encodes points [begin, begin + count) into binary records at \p records.
+            void EncodePCDRecords(const PCDHeader &header,
+                                  const PCDSlotBinding *bindings,
+                                  size_t begin,
+                                  size_t count,
+                                  char *records);
+
+            /// \brief Packs the fields into stripes and compresses them.
+            ///
+            /// Runs before the header is written so that the header can carry the
+            /// block index. The payload is left in \p scratch.compressed.
+            bool CompressPCDData(PCDHeader &header,
+                                 const PCDSlotBinding *bindings,
+                                 const WritePointCloudOption &params,
+                                 PCDScratch &scratch);
+
+            /// \brief Writes the first \p points points of \p bindings as ascii lines
+            /// or binary records, following the data type of \p header.
+            ///
+            /// ascii lines are formatted in parallel blocks on the global thread
+            /// pool, using up to \p num_threads threads (0 for all of them). The
+            /// data size and timings are added to \p stats when not NULL.
+            bool WritePCDRecords(FILE *file,
+                                 const PCDHeader &header,
+                                 const PCDSlotBinding *bindings,
+                                 size_t points,
+                                 PCDScratch &scratch,
+                                 int num_threads = 0,
+                                 IOStats *stats = NULL);
+
+            bool WritePCDData(FILE *file,
+                              const PCDHeader &header,
+                              const PCDSlotBinding *bindings,
+                              const WritePointCloudOption &params,
+                              PCDScratch &scratch);
+
+            template <typename Scalar>
+            void BindSlots(const geometry::BasicPointCloudSoA<Scalar> &pointcloud,
+                           PCDSlotBinding *bindings)
+            {
+                const PCDSlotType type = PCDSlotTypeOf<Scalar>::value;
+                bindings[PCD_SLOT_X] = {(char *)pointcloud.x_.data(), sizeof(Scalar), type};
+                bindings[PCD_SLOT_Y] = {(char *)pointcloud.y_.data(), sizeof(Scalar), type};
+                bindings[PCD_SLOT_Z] = {(char *)pointcloud.z_.data(), sizeof(Scalar), type};
+                bindings[PCD_SLOT_NORMAL_X] = {(char *)pointcloud.normal_x_.data(),
+                                               sizeof(Scalar), type};
+                bindings[PCD_SLOT_NORMAL_Y] = {(char *)pointcloud.normal_y_.data(),
+                                               sizeof(Scalar), type};
+                bindings[PCD_SLOT_NORMAL_Z] = {(char *)pointcloud.normal_z_.data(),
+                                               sizeof(Scalar), type};
+                bindings[PCD_SLOT_INTENSITY] = {(char *)pointcloud.intensity_.data(),
+                                                sizeof(Scalar), type};
+                bindings[PCD_SLOT_RGB] = {(char *)pointcloud.rgb_.data(),
+                                          sizeof(std::uint32_t), PCD_SLOT_PACKED_RGB};
+            }
+
+            template <typename Scalar>
+            void PrepareSlotBindings(const PCDHeader &header,
+                                     size_t points,
+                                     geometry::BasicPointCloudSoA<Scalar> &pointcloud,
+                                     PCDSlotBinding *bindings)
+            {
+                pointcloud.Resize(points, header.has_intensitys,
+                                  header.has_normals, header.has_colors);
+                BindSlots(pointcloud, bindings);
+            }
+
+            template <typename Scalar>
+            bool GenerateHeader(const geometry::BasicPointCloudSoA<Scalar> &pointcloud,
+                                const bool write_ascii,
+                                const bool compressed,
+                                PCDHeader &header)
+            {
+                if (!pointcloud.HasPoints())
+                {
+                    return false;
+                }
+                return GenerateHeader(pointcloud.Size(), pointcloud.HasIntensitys(),
+                                      pointcloud.HasNormals(), pointcloud.HasColors(),
+                                      write_ascii, compressed, header);
+            }
+        } // namespace internal
+    } // namespace io
+} // namespace pcd
@@ -0,0 +1,45 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "PCDIOContext.h"
+
+#include "PCDFormat.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        PCDIOContext::PCDIOContext() : scratch_(new internal::PCDScratch) {}
+
+        PCDIOContext::~PCDIOContext() = default;
+
+        size_t PCDIOContext::Capacity() const
+        {
+            const internal::PCDScratch &scratch = *scratch_;
+            size_t capacity = scratch.stripes.Capacity() + scratch.filtered.Capacity() +
+                              scratch.compressed.output.Capacity() +
+                              scratch.compressed.blocks.capacity() * sizeof(internal::LZFBlock);
+            for (const auto &records : scratch.records)
+            {
+                capacity += records.Capacity();
+            }
+            for (const auto &text : scratch.texts)
+            {
+                capacity += text.Capacity();
+            }
+            return capacity;
+        }
+
+        void PCDIOContext::Release()
+        {
+            scratch_.reset(new internal::PCDScratch);
+        }
+
+        internal::PCDScratch &PCDIOContext::Scratch()
+        {
+            return *scratch_;
+        }
+    } // namespace io
+} // namespace pcd
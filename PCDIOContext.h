@@ -0,0 +1,55 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "Geometry.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        namespace internal
+        {
+            struct PCDScratch;
+        } // namespace internal
+
+        /// \class PCDIOContext
+        ///
+        /// \brief Working memory reused by the reads and writes it is passed to.
+        ///
+        /// Set ReadPointCloudOption::context or WritePointCloudOption::context to
+        /// keep the decompressed and filtered stripes, the compressed blocks and
+        /// the record and text blocks between calls. The buffers only grow, so
+        /// once they fit the largest file, reading or writing files of that size
+        /// again allocates no data buffers. Without a context every call
+        /// allocates its own.
+        ///
+        /// A context serves one call at a time; give every thread its own.
+        class PCDIO_EXPORTS PCDIOContext
+        {
+        public:
+            PCDIOContext();
+            ~PCDIOContext();
+            PCDIOContext(const PCDIOContext &) = delete;
+            PCDIOContext &operator=(const PCDIOContext &) = delete;
+
+        public:
+            /// Bytes held by the buffers.
+            size_t Capacity() const;
+            /// Frees the buffers, e.g. after an unusually large file.
+            void Release();
+
+            /// Buffers handed to the readers and writers.
+            internal::PCDScratch &Scratch();
+
+        private:
+            std::unique_ptr<internal::PCDScratch> scratch_;
+        };
+    } // namespace io
+} // namespace pcd
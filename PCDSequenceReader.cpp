@@ -0,0 +1,270 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "PCDSequenceReader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include "Logging.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        namespace
+        {
+            const size_t kNoFrame = (size_t)-1;
+
+            /// Matches \p name against \p pattern, where `*` matches any run of
+            /// characters and `?` any single character.
+            bool MatchWildcard(const char *pattern, const char *name)
+            {
+                const char *star = NULL;
+                const char *resume = NULL;
+                while (*name != '\0')
+                {
+                    if (*pattern == '*')
+                    {
+                        star = pattern++;
+                        resume = name;
+                    }
+                    else if (*pattern == '?' || *pattern == *name)
+                    {
+                        pattern++;
+                        name++;
+                    }
+                    else if (star != NULL)
+                    {
+                        pattern = star + 1;
+                        name = ++resume;
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+                while (*pattern == '*')
+                {
+                    pattern++;
+                }
+                return *pattern == '\0';
+            }
+
+            /// Exchanges the attributes of two clouds without copying them; the
+            /// user-declared destructor of PointCloud leaves it without moves.
+            void SwapPointClouds(geometry::PointCloud &a, geometry::PointCloud &b)
+            {
+                a.points_.swap(b.points_);
+                a.intensitys_.swap(b.intensitys_);
+                a.normals_.swap(b.normals_);
+                a.colors_.swap(b.colors_);
+                a.covariances_.swap(b.covariances_);
+            }
+        } // unnamed namespace
+
+        struct PCDSequenceReader::Impl
+        {
+            /// One ring entry, holding frame `frame` once it has been loaded.
+            struct Slot
+            {
+                geometry::PointCloud cloud;
+                size_t frame = kNoFrame;
+                bool ok = false;
+            };
+
+            size_t prefetch;
+            size_t num_threads;
+            std::vector<std::string> filenames;
+            ReadPointCloudOption params;
+            std::vector<Slot> slots;
+            std::vector<std::thread> loaders;
+            bool open = false;
+            bool failed = false;
+
+            std::mutex mutex;
+            // signalled when a slot is handed out or Close() stops the loaders
+            std::condition_variable slot_free;
+            // signalled when a frame has been loaded
+            std::condition_variable frame_ready;
+            size_t next_load = 0;
+            size_t next_read = 0;
+            bool stop = false;
+
+            void LoaderLoop()
+            {
+                // every loader reuses its own buffers across the frames it loads
+                PCDIOContext context;
+                ReadPointCloudOption frame_params = params;
+                frame_params.context = &context;
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;)
+                {
+                    slot_free.wait(lock, [this] {
+                        return stop || next_load >= filenames.size() ||
+                               next_load < next_read + prefetch;
+                    });
+                    if (stop || next_load >= filenames.size())
+                    {
+                        return;
+                    }
+                    size_t frame = next_load++;
+                    Slot &slot = slots[frame % prefetch];
+                    lock.unlock();
+                    bool ok = ReadPointCloudFromPCD(filenames[frame], slot.cloud, frame_params);
+                    lock.lock();
+                    slot.frame = frame;
+                    slot.ok = ok;
+                    frame_ready.notify_all();
+                }
+            }
+        };
+
+        PCDSequenceReader::PCDSequenceReader(size_t prefetch, size_t num_threads)
+            : impl_(new Impl)
+        {
+            impl_->prefetch = std::max<size_t>(prefetch, 1);
+            impl_->num_threads = std::min(std::max<size_t>(num_threads, 1), impl_->prefetch);
+        }
+
+        PCDSequenceReader::~PCDSequenceReader() { Close(); }
+
+        bool PCDSequenceReader::Open(const std::vector<std::string> &filenames,
+                                     const ReadPointCloudOption &params)
+        {
+            Close();
+            Impl &impl = *impl_;
+            impl.filenames = filenames;
+            impl.params = params;
+            impl.params.stats = nullptr;
+            impl.params.context = nullptr;
+            impl.slots.resize(impl.prefetch);
+            for (auto &slot : impl.slots)
+            {
+                slot.frame = kNoFrame;
+            }
+            impl.next_load = impl.next_read = 0;
+            impl.stop = false;
+            impl.failed = false;
+            impl.open = true;
+            size_t num_threads = std::min(impl.num_threads, filenames.size());
+            for (size_t i = 0; i < num_threads; i++)
+            {
+                impl.loaders.emplace_back(&Impl::LoaderLoop, &impl);
+            }
+            return true;
+        }
+
+        bool PCDSequenceReader::OpenGlob(const std::string &pattern,
+                                         const ReadPointCloudOption &params)
+        {
+            std::vector<std::string> filenames = Glob(pattern);
+            if (filenames.empty())
+            {
+                Close();
+                utility::LogError("[PCDSequenceReader] No file matches %s\n", pattern.c_str());
+                return false;
+            }
+            return Open(filenames, params);
+        }
+
+        void PCDSequenceReader::Close()
+        {
+            Impl &impl = *impl_;
+            {
+                std::lock_guard<std::mutex> lock(impl.mutex);
+                impl.stop = true;
+            }
+            impl.slot_free.notify_all();
+            for (auto &loader : impl.loaders)
+            {
+                loader.join();
+            }
+            impl.loaders.clear();
+            impl.filenames.clear();
+            impl.next_load = impl.next_read = 0;
+            impl.open = false;
+        }
+
+        bool PCDSequenceReader::IsOpen() const { return impl_->open; }
+
+        size_t PCDSequenceReader::Prefetch() const { return impl_->prefetch; }
+
+        size_t PCDSequenceReader::NumFrames() const { return impl_->filenames.size(); }
+
+        size_t PCDSequenceReader::FramesRead() const
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
+            return impl_->next_read;
+        }
+
+        bool PCDSequenceReader::HasError() const { return impl_->failed; }
+
+        bool PCDSequenceReader::Next(geometry::PointCloud &frame, std::string *filename)
+        {
+            Impl &impl = *impl_;
+            std::unique_lock<std::mutex> lock(impl.mutex);
+            while (impl.open && impl.next_read < impl.filenames.size())
+            {
+                size_t index = impl.next_read;
+                Impl::Slot &slot = impl.slots[index % impl.prefetch];
+                impl.frame_ready.wait(lock, [&] { return slot.frame == index; });
+                bool ok = slot.ok;
+                if (ok)
+                {
+                    SwapPointClouds(frame, slot.cloud);
+                }
+                slot.frame = kNoFrame;
+                impl.next_read++;
+                impl.slot_free.notify_all();
+                if (ok)
+                {
+                    if (filename != nullptr)
+                    {
+                        *filename = impl.filenames[index];
+                    }
+                    return true;
+                }
+                impl.failed = true;
+                utility::LogError("[PCDSequenceReader] Skipping unreadable frame %s\n",
+                                  impl.filenames[index].c_str());
+            }
+            return false;
+        }
+
+        std::vector<std::string> PCDSequenceReader::Glob(const std::string &pattern)
+        {
+            namespace fs = std::filesystem;
+            std::vector<std::string> filenames;
+            fs::path path(pattern);
+            std::string name = path.filename().string();
+            if (name.find_first_of("*?") == std::string::npos)
+            {
+                std::error_code error;
+                if (fs::is_regular_file(path, error))
+                {
+                    filenames.push_back(pattern);
+                }
+                return filenames;
+            }
+            fs::path directory = path.parent_path();
+            std::error_code error;
+            fs::directory_iterator it(directory.empty() ? fs::path(".") : directory, error);
+            for (; !error && it != fs::directory_iterator(); it.increment(error))
+            {
+                std::string entry = it->path().filename().string();
+                if (MatchWildcard(name.c_str(), entry.c_str()) && it->is_regular_file(error))
+                {
+                    filenames.push_back((directory / entry).string());
+                }
+            }
+            std::sort(filenames.begin(), filenames.end());
+            return filenames;
+        }
+    } // namespace io
+} // namespace pcd
@@ -0,0 +1,86 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PointCloud.h"
+#include "PointCloudIO.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        /// \class PCDSequenceReader
+        ///
+        /// \brief Reads a sequence of PCD frames in order while background
+        /// threads decode the frames ahead of it.
+        ///
+        /// Up to Prefetch() frames are loaded ahead into a ring of clouds. A
+        /// loader only starts a frame once its ring slot has been handed out, so
+        /// memory stays bounded when the consumer falls behind. Next() swaps the
+        /// frame into the caller's cloud, and the caller's previous storage goes
+        /// back to the ring to be reused by a later frame.
+        class PCDIO_EXPORTS PCDSequenceReader
+        {
+        public:
+            /// \param prefetch Number of frames decoded ahead of the consumer.
+            /// \param num_threads Number of frames loaded at the same time.
+            explicit PCDSequenceReader(size_t prefetch = 4, size_t num_threads = 1);
+            ~PCDSequenceReader();
+            PCDSequenceReader(const PCDSequenceReader &) = delete;
+            PCDSequenceReader &operator=(const PCDSequenceReader &) = delete;
+
+        public:
+            /// \brief Starts loading \p filenames in the given order, closing any
+            /// previous sequence first.
+            ///
+            /// \p params applies to every frame; its `stats` and `context`
+            /// pointers are ignored because frames load concurrently. Every
+            /// loader thread reuses a PCDIOContext of its own instead.
+            bool Open(const std::vector<std::string> &filenames,
+                      const ReadPointCloudOption &params = ReadPointCloudOption());
+            /// \brief Starts loading the files matching \p pattern, sorted by name.
+            ///
+            /// See Glob() for the supported patterns. Returns `false` if nothing
+            /// matches.
+            bool OpenGlob(const std::string &pattern,
+                          const ReadPointCloudOption &params = ReadPointCloudOption());
+            /// Stops the loaders and drops the frames not handed out yet.
+            void Close();
+            bool IsOpen() const;
+
+            /// Maximum number of frames decoded ahead.
+            size_t Prefetch() const;
+            /// Number of frames in the sequence.
+            size_t NumFrames() const;
+            /// Number of frames handed out or skipped so far.
+            size_t FramesRead() const;
+            /// Returns `true` if at least one frame failed to load and was skipped.
+            bool HasError() const;
+
+            /// \brief Waits for the next frame and swaps it into \p frame.
+            ///
+            /// Frames that fail to load are logged and skipped. Returns `false`
+            /// once the sequence is exhausted.
+            ///
+            /// \param filename If not NULL, receives the file of the frame.
+            bool Next(geometry::PointCloud &frame, std::string *filename = nullptr);
+
+            /// \brief Lists the files matching \p pattern, sorted by name.
+            ///
+            /// `*` and `?` are expanded in the file name only, e.g.
+            /// `/data/run1/*.pcd`; the directory part is taken literally.
+            static std::vector<std::string> Glob(const std::string &pattern);
+
+        private:
+            struct Impl;
+            std::unique_ptr<Impl> impl_;
+        };
+    } // namespace io
+} // namespace pcd
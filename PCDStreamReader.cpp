@@ -0,0 +1,342 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "PCDStreamReader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include <string.h>
+
+#include "Logging.h"
+#include "PCDFormat.h"
+
+// Bytes requested from the file per read while looking for lines.
+#define PCD_STREAM_CHUNK_BYTES (1 << 20)
+
+namespace pcd
+{
+    namespace io
+    {
+        using namespace internal;
+
+        struct PCDStreamReader::Impl
+        {
+            size_t batch_size;
+            FILE *file = NULL;
+            // size of the file, 0 if unknown, and bytes read from it so far
+            size_t file_size = 0;
+            size_t file_offset = 0;
+            PCDHeader header;
+            size_t points_read = 0;
+            bool failed = false;
+            // bytes read from the file but not consumed yet
+            std::vector<char> pending;
+            size_t pending_begin = 0;
+            size_t pending_end = 0;
+            bool eof = false;
+            // decompressed binary_compressed stripes
+            std::unique_ptr<char[]> stripes;
+            // scratch space for the binary records of one batch
+            std::vector<char> records;
+            // token bounds of the ascii line being decoded
+            std::vector<const char *> tokens;
+            geometry::PointCloud callback_batch;
+
+            /// Moves the unconsumed bytes to the front of the buffer and appends at
+            /// least one more chunk from the file. Returns `false` at end of file.
+            bool Fill()
+            {
+                if (eof)
+                {
+                    return false;
+                }
+                size_t size = pending_end - pending_begin;
+                if (size > 0)
+                {
+                    memmove(pending.data(), pending.data() + pending_begin, size);
+                }
+                pending_begin = 0;
+                pending_end = size;
+                pending.resize(size + PCD_STREAM_CHUNK_BYTES);
+                size_t got = fread(pending.data() + size, 1, PCD_STREAM_CHUNK_BYTES, file);
+                file_offset += got;
+                pending_end += got;
+                if (got < PCD_STREAM_CHUNK_BYTES)
+                {
+                    eof = true;
+                }
+                return got > 0;
+            }
+
+            /// Copies \p size bytes into \p dst, draining the pending bytes before
+            /// reading from the file. Returns the number of bytes copied.
+            size_t Read(char *dst, size_t size)
+            {
+                size_t from_pending = std::min(size, pending_end - pending_begin);
+                memcpy(dst, pending.data() + pending_begin, from_pending);
+                pending_begin += from_pending;
+                if (from_pending == size)
+                {
+                    return size;
+                }
+                size_t got = fread(dst + from_pending, 1, size - from_pending, file);
+                file_offset += got;
+                return from_pending + got;
+            }
+
+            /// Number of bytes left to Read(), SIZE_MAX if the file size is unknown.
+            size_t Remaining() const
+            {
+                if (file_size == 0)
+                {
+                    return SIZE_MAX;
+                }
+                return pending_end - pending_begin +
+                       (file_size > file_offset ? file_size - file_offset : 0);
+            }
+
+            bool ReadHeader()
+            {
+                const char *header_end = NULL;
+                while (header_end == NULL)
+                {
+                    if (!Fill())
+                    {
+                        utility::LogError("[PCDStreamReader] Unable to find the DATA line.\n");
+                        return false;
+                    }
+                    header_end = FindPCDHeaderEnd(pending.data(), pending.data() + pending_end);
+                }
+                const char *data = pending.data();
+                if (!ReadPCDHeader(data, header_end, header))
+                {
+                    return false;
+                }
+                pending_begin = header_end - pending.data();
+                return true;
+            }
+
+            /// Reads and decompresses the whole binary_compressed payload.
+            bool ReadStripes()
+            {
+                std::uint32_t sizes[2];
+                if (Read((char *)sizes, sizeof(sizes)) != sizeof(sizes))
+                {
+                    utility::LogError("[PCDStreamReader] Failed to read data record.\n");
+                    return false;
+                }
+                std::uint32_t compressed_size = sizes[0];
+                std::uint32_t uncompressed_size = sizes[1];
+                if ((size_t)uncompressed_size < (size_t)header.points * header.pointsize)
+                {
+                    utility::LogError("[PCDStreamReader] Uncompressed size does not match the header.\n");
+                    return false;
+                }
+                // Sizes come from the file, check them before allocating.
+                if (compressed_size > Remaining())
+                {
+                    utility::LogError("[PCDStreamReader] Failed to read data record.\n");
+                    return false;
+                }
+                std::unique_ptr<char[]> compressed(new char[compressed_size]);
+                if (Read(compressed.get(), compressed_size) != compressed_size)
+                {
+                    utility::LogError("[PCDStreamReader] Failed to read data record.\n");
+                    return false;
+                }
+                stripes.reset(new char[uncompressed_size]);
+                if (!DecompressBlocks(header, compressed.get(), compressed_size,
+                                      stripes.get(), uncompressed_size))
+                {
+                    utility::LogError("[PCDStreamReader] Uncompression failed.\n");
+                    stripes.reset();
+                    return false;
+                }
+                if (header.filter != PCD_FILTER_NONE)
+                {
+                    std::unique_ptr<char[]> unfiltered(new char[uncompressed_size]);
+                    UnfilterPCDStripes(header, stripes.get(), unfiltered.get());
+                    stripes.swap(unfiltered);
+                }
+                // Nothing else is read from the file.
+                std::vector<char>().swap(pending);
+                pending_begin = pending_end = 0;
+                return true;
+            }
+
+            /// Decodes up to \p count ascii lines into \p bindings and returns the
+            /// number of points decoded.
+            size_t ReadLines(const PCDSlotBinding *bindings, size_t count)
+            {
+                size_t idx = 0;
+                while (idx < count)
+                {
+                    const char *begin = pending.data() + pending_begin;
+                    const char *end = pending.data() + pending_end;
+                    const char *eol = static_cast<const char *>(memchr(begin, '\n', end - begin));
+                    if (eol == NULL && Fill())
+                    {
+                        continue;
+                    }
+                    if (begin == end)
+                    {
+                        break;
+                    }
+                    // The last line of the file may lack its terminator.
+                    const char *line_end = eol == NULL ? end : eol;
+                    if (DecodePCDLine(header, bindings, begin, line_end, idx, tokens))
+                    {
+                        idx++;
+                    }
+                    pending_begin = eol == NULL ? pending_end : eol + 1 - pending.data();
+                }
+                return idx;
+            }
+
+            template <typename PointCloudT>
+            bool Next(PointCloudT &batch)
+            {
+                if (file == NULL || failed || points_read >= (size_t)header.points)
+                {
+                    return false;
+                }
+                size_t count = std::min(batch_size, (size_t)header.points - points_read);
+                PCDSlotBinding bindings[PCD_SLOT_COUNT];
+                PrepareSlotBindings(header, count, batch, bindings);
+                if (header.datatype == PCD_DATA_ASCII)
+                {
+                    size_t decoded = ReadLines(bindings, count);
+                    if (decoded < count)
+                    {
+                        // Truncated file: hand out what was found and stop there.
+                        utility::LogError("[PCDStreamReader] Data ends after %zu of %d points.\n",
+                                          points_read + decoded, header.points);
+                        PrepareSlotBindings(header, decoded, batch, bindings);
+                        points_read += decoded;
+                        failed = true;
+                        return decoded > 0;
+                    }
+                }
+                else if (header.datatype == PCD_DATA_BINARY)
+                {
+                    size_t size = count * header.pointsize;
+                    records.resize(size);
+                    if (Read(records.data(), size) != size)
+                    {
+                        utility::LogError("[PCDStreamReader] Failed to read data record.\n");
+                        failed = true;
+                        return false;
+                    }
+                    DecodePCDRecords(header, bindings, records.data(), 0, count);
+                }
+                else if (header.datatype == PCD_DATA_BINARY_COMPRESSED)
+                {
+                    DecodePCDStripes(header, bindings, stripes.get(), points_read, 0, count);
+                }
+                points_read += count;
+                return true;
+            }
+        };
+
+        PCDStreamReader::PCDStreamReader(size_t batch_size) : impl_(new Impl)
+        {
+            impl_->batch_size = std::max<size_t>(batch_size, 1);
+        }
+
+        PCDStreamReader::~PCDStreamReader() { Close(); }
+
+        bool PCDStreamReader::Open(const std::string &filename)
+        {
+            Close();
+            impl_->file = fopen(filename.c_str(), "rb");
+            if (impl_->file == NULL)
+            {
+                utility::LogError("[PCDStreamReader] Unable to open file: %s\n", filename.c_str());
+                return false;
+            }
+            std::error_code error;
+            auto file_size = std::filesystem::file_size(filename, error);
+            impl_->file_size = error ? 0 : (size_t)file_size;
+            if (!impl_->ReadHeader() ||
+                (impl_->header.datatype == PCD_DATA_BINARY_COMPRESSED && !impl_->ReadStripes()))
+            {
+                Close();
+                impl_->failed = true;
+                return false;
+            }
+            return true;
+        }
+
+        void PCDStreamReader::Close()
+        {
+            if (impl_->file != NULL)
+            {
+                fclose(impl_->file);
+            }
+            size_t batch_size = impl_->batch_size;
+            impl_.reset(new Impl);
+            impl_->batch_size = batch_size;
+        }
+
+        bool PCDStreamReader::IsOpen() const { return impl_->file != NULL; }
+
+        size_t PCDStreamReader::BatchSize() const { return impl_->batch_size; }
+
+        size_t PCDStreamReader::NumPoints() const
+        {
+            return IsOpen() ? (size_t)impl_->header.points : 0;
+        }
+
+        size_t PCDStreamReader::PointsRead() const { return impl_->points_read; }
+
+        bool PCDStreamReader::HasIntensitys() const
+        {
+            return IsOpen() && impl_->header.has_intensitys;
+        }
+
+        bool PCDStreamReader::HasNormals() const
+        {
+            return IsOpen() && impl_->header.has_normals;
+        }
+
+        bool PCDStreamReader::HasColors() const
+        {
+            return IsOpen() && impl_->header.has_colors;
+        }
+
+        bool PCDStreamReader::HasError() const { return impl_->failed; }
+
+        bool PCDStreamReader::Next(geometry::PointCloud &batch)
+        {
+            return impl_->Next(batch);
+        }
+
+        bool PCDStreamReader::Next(geometry::PointCloudSoA &batch)
+        {
+            return impl_->Next(batch);
+        }
+
+        bool PCDStreamReader::Next(geometry::PointCloudSoAd &batch)
+        {
+            return impl_->Next(batch);
+        }
+
+        bool PCDStreamReader::ForEach(
+            const std::function<bool(const geometry::PointCloud &)> &callback)
+        {
+            while (Next(impl_->callback_batch))
+            {
+                if (!callback(impl_->callback_batch))
+                {
+                    break;
+                }
+            }
+            return !HasError();
+        }
+    } // namespace io
+} // namespace pcd
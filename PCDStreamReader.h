@@ -0,0 +1,72 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "PointCloud.h"
+#include "PointCloudSoA.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        /// \class PCDStreamReader
+        ///
+        /// \brief Reads a PCD file as a sequence of fixed-size point batches.
+        ///
+        /// The header is parsed once by Open(), then every call to Next() decodes
+        /// at most BatchSize() points, so ascii and binary files are read with
+        /// memory bounded by the batch size. binary_compressed files store their
+        /// fields one after another, so their decompressed data is kept for the
+        /// lifetime of the stream.
+        class PCDIO_EXPORTS PCDStreamReader
+        {
+        public:
+            /// \param batch_size Maximum number of points returned by Next().
+            explicit PCDStreamReader(size_t batch_size = 1 << 20);
+            ~PCDStreamReader();
+            PCDStreamReader(const PCDStreamReader &) = delete;
+            PCDStreamReader &operator=(const PCDStreamReader &) = delete;
+
+        public:
+            /// \brief Opens \p filename and parses its header.
+            bool Open(const std::string &filename);
+            void Close();
+            bool IsOpen() const;
+
+            /// Maximum number of points returned by one batch.
+            size_t BatchSize() const;
+            /// Number of points announced by the header.
+            size_t NumPoints() const;
+            /// Number of points returned so far.
+            size_t PointsRead() const;
+            bool HasIntensitys() const;
+            bool HasNormals() const;
+            bool HasColors() const;
+            /// Returns `true` if reading stopped because of a malformed or
+            /// truncated file rather than at the end of the data.
+            bool HasError() const;
+
+            /// \brief Decodes the next batch into \p batch, reusing its storage.
+            ///
+            /// Returns `false` once all points have been read or on error.
+            bool Next(geometry::PointCloud &batch);
+            bool Next(geometry::PointCloudSoA &batch);
+            bool Next(geometry::PointCloudSoAd &batch);
+
+            /// \brief Calls \p callback with every remaining batch until the data
+            /// ends or \p callback returns `false`. Returns `false` on error.
+            bool ForEach(const std::function<bool(const geometry::PointCloud &)> &callback);
+
+        private:
+            struct Impl;
+            std::unique_ptr<Impl> impl_;
+        };
+    } // namespace io
+} // namespace pcd
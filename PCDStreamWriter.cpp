@@ -0,0 +1,373 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "PCDStreamWriter.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Logging.h"
+#include "PCDFormat.h"
+#include "ThreadPool.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        using namespace internal;
+
+        namespace
+        {
+            size_t CountPoints(const geometry::PointCloud &pointcloud)
+            {
+                return pointcloud.points_.size();
+            }
+
+            template <typename Scalar>
+            size_t CountPoints(const geometry::BasicPointCloudSoA<Scalar> &pointcloud)
+            {
+                return pointcloud.Size();
+            }
+        } // unnamed namespace
+
+        struct PCDStreamWriter::Impl
+        {
+            FILE *file = NULL;
+            PCDHeader header;
+            WritePointCloudOption params;
+            size_t points = 0;
+            bool failed = false;
+            // one staging file per planned field, binary_compressed only
+            std::vector<FILE *> stripes;
+            // scratch space for one block of encoded values
+            std::unique_ptr<char[]> scratch;
+            // record and text blocks reused by every Append()
+            PCDScratch buffers;
+
+            ~Impl()
+            {
+                for (FILE *stripe : stripes)
+                {
+                    fclose(stripe);
+                }
+                if (file != NULL)
+                {
+                    fclose(file);
+                }
+            }
+
+            template <typename PointCloudT>
+            bool Append(const PointCloudT &batch)
+            {
+                if (file == NULL || failed)
+                {
+                    return false;
+                }
+                size_t count = CountPoints(batch);
+                if (count == 0)
+                {
+                    return true;
+                }
+                if ((header.has_intensitys && !batch.HasIntensitys()) ||
+                    (header.has_normals && !batch.HasNormals()) ||
+                    (header.has_colors && !batch.HasColors()))
+                {
+                    utility::LogError("[PCDStreamWriter] Batch lacks attributes declared on Open.\n");
+                    return false;
+                }
+                size_t limit = header.datatype == PCD_DATA_BINARY_COMPRESSED
+                                   ? UINT32_MAX / header.pointsize
+                                   : INT_MAX;
+                if (points + count > limit)
+                {
+                    utility::LogError("[PCDStreamWriter] Too many points for one PCD file.\n");
+                    return false;
+                }
+                PCDSlotBinding bindings[PCD_SLOT_COUNT];
+                BindSlots(batch, bindings);
+                if (header.datatype != PCD_DATA_BINARY_COMPRESSED)
+                {
+                    failed = !WritePCDRecords(file, header, bindings, count, buffers,
+                                              params.num_threads, params.stats);
+                }
+                else
+                {
+                    failed = !StageStripes(bindings, count);
+                }
+                if (!failed)
+                {
+                    points += count;
+                }
+                return !failed;
+            }
+
+            /// Appends the values of every field to its staging file.
+            bool StageStripes(const PCDSlotBinding *bindings, size_t count)
+            {
+                for (size_t i = 0; i < header.plan.size(); i++)
+                {
+                    const auto &codec = header.plan[i];
+                    const auto &binding = bindings[codec.slot];
+                    for (size_t begin = 0; begin < count; begin += PCD_RECORD_BLOCK_POINTS)
+                    {
+                        size_t block = std::min((size_t)PCD_RECORD_BLOCK_POINTS, count - begin);
+                        {
+                            ScopedTimer timer(params.stats, &IOStats::conversion_seconds);
+                            codec.encode[binding.type](binding.base + begin * binding.stride,
+                                                       binding.stride, scratch.get(),
+                                                       codec.stripe_stride, block);
+                        }
+                        ScopedTimer timer(params.stats, &IOStats::io_seconds);
+                        if (fwrite(scratch.get(), codec.stripe_stride, block, stripes[i]) != block)
+                        {
+                            utility::LogError("[PCDStreamWriter] Failed to stage data.\n");
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            /// Reads up to \p size bytes of the concatenated staging files.
+            size_t ReadStripes(size_t &current, char *dst, size_t size)
+            {
+                size_t done = 0;
+                while (done < size && current < stripes.size())
+                {
+                    size_t got = fread(dst + done, 1, size - done, stripes[current]);
+                    done += got;
+                    if (got == 0)
+                    {
+                        current++;
+                    }
+                }
+                return done;
+            }
+
+            /// Compresses the staged stripes and writes header and data.
+            bool WriteCompressed()
+            {
+                for (FILE *stripe : stripes)
+                {
+                    rewind(stripe);
+                }
+                FILE *blocks_file = tmpfile();
+                if (blocks_file == NULL)
+                {
+                    utility::LogError("[PCDStreamWriter] Unable to create a staging file.\n");
+                    return false;
+                }
+                // Compress as many blocks per round as there are threads.
+                size_t block_size = std::max<size_t>(params.compression_block_size, 1024);
+                size_t num_threads = params.num_threads > 0
+                                         ? (size_t)params.num_threads
+                                         : utility::ThreadPool::Global().NumThreads();
+                size_t round_size = block_size * num_threads;
+                std::unique_ptr<char[]> buffer(new char[round_size]);
+                std::vector<LZFBlock> blocks;
+                PCDScratchBuffer output;
+                size_t uncompressed_size = points * header.pointsize;
+                size_t compressed_size = 0;
+                size_t current = 0;
+                header.lzf_block_size = block_size;
+                header.lzf_blocks.clear();
+                for (size_t offset = 0; offset < uncompressed_size; offset += round_size)
+                {
+                    // Only the last round may end on a partial block, so every
+                    // other block keeps the nominal size the index relies on.
+                    size_t size = std::min(round_size, uncompressed_size - offset);
+                    bool ok;
+                    {
+                        ScopedTimer timer(params.stats, &IOStats::io_seconds);
+                        ok = ReadStripes(current, buffer.get(), size) == size;
+                    }
+                    if (ok)
+                    {
+                        ScopedTimer timer(params.stats, &IOStats::compression_seconds);
+                        ok = CompressBlocks(buffer.get(), size, block_size, (int)num_threads,
+                                            *header.codec, (int)params.compression_level,
+                                            blocks, output) != 0;
+                    }
+                    if (!ok)
+                    {
+                        utility::LogError("[PCDStreamWriter] Failed to compress data.\n");
+                        fclose(blocks_file);
+                        return false;
+                    }
+                    ScopedTimer timer(params.stats, &IOStats::io_seconds);
+                    for (const auto &block : blocks)
+                    {
+                        if (fwrite(output.Data() + block.output_offset, 1,
+                                   block.compressed_size, blocks_file) != block.compressed_size)
+                        {
+                            utility::LogError("[PCDStreamWriter] Failed to stage data.\n");
+                            fclose(blocks_file);
+                            return false;
+                        }
+                        header.lzf_blocks.push_back(block.compressed_size);
+                        compressed_size += block.compressed_size;
+                    }
+                }
+                if (compressed_size > UINT32_MAX)
+                {
+                    utility::LogError("[PCDStreamWriter] Data is too large for binary_compressed.\n");
+                    fclose(blocks_file);
+                    return false;
+                }
+                if (params.stats != NULL)
+                {
+                    params.stats->data_bytes = uncompressed_size;
+                    params.stats->compression_ratio =
+                        compressed_size > 0 ? (double)uncompressed_size / compressed_size : 1.0;
+                }
+                // The header grows by the block index, so everything is rewritten.
+                ScopedTimer timer(params.stats, &IOStats::io_seconds);
+                rewind(blocks_file);
+                std::uint32_t sizes[2] = {(std::uint32_t)compressed_size,
+                                          (std::uint32_t)uncompressed_size};
+                bool ok = fseek(file, 0, SEEK_SET) == 0 &&
+                          WritePCDHeader(file, header, true) &&
+                          fwrite(sizes, sizeof(sizes), 1, file) == 1;
+                for (size_t got = round_size; ok && got == round_size;)
+                {
+                    got = fread(buffer.get(), 1, round_size, blocks_file);
+                    ok = fwrite(buffer.get(), 1, got, file) == got;
+                }
+                fclose(blocks_file);
+                if (!ok)
+                {
+                    utility::LogError("[PCDStreamWriter] Failed to write data record.\n");
+                }
+                return ok;
+            }
+        };
+
+        PCDStreamWriter::PCDStreamWriter() : impl_(new Impl) {}
+
+        PCDStreamWriter::~PCDStreamWriter() { Close(); }
+
+        bool PCDStreamWriter::Open(const std::string &filename,
+                                   bool has_intensitys,
+                                   bool has_normals,
+                                   bool has_colors,
+                                   const WritePointCloudOption &params)
+        {
+            Close();
+            Impl &impl = *impl_;
+            impl.params = params;
+            if (params.stats != NULL)
+            {
+                *params.stats = IOStats();
+            }
+            ScopedTimer timer(params.stats, &IOStats::header_seconds);
+            // Describe a single point, the real sizes are set on Close.
+            if (!GenerateHeader(1, has_intensitys, has_normals, has_colors,
+                                bool(params.write_ascii), bool(params.compressed),
+                                impl.header))
+            {
+                utility::LogError("[PCDStreamWriter] Unable to generate header.\n");
+                return false;
+            }
+            impl.header.width = 0;
+            impl.header.points = 0;
+            impl.header.codec = FindBlockCodec(params.compression_codec);
+            if (impl.header.codec == NULL)
+            {
+                utility::LogError("[PCDStreamWriter] Unknown compression codec %s.\n",
+                                  params.compression_codec.c_str());
+                impl_.reset(new Impl);
+                return false;
+            }
+            if (impl.header.datatype == PCD_DATA_BINARY_COMPRESSED)
+            {
+                for (size_t i = 0; i < impl.header.plan.size(); i++)
+                {
+                    FILE *stripe = tmpfile();
+                    if (stripe == NULL)
+                    {
+                        utility::LogError("[PCDStreamWriter] Unable to create a staging file.\n");
+                        impl_.reset(new Impl);
+                        return false;
+                    }
+                    impl.stripes.push_back(stripe);
+                }
+                impl.scratch.reset(new char[(size_t)PCD_RECORD_BLOCK_POINTS * sizeof(double)]);
+            }
+            impl.file = fopen(filename.c_str(), "wb");
+            if (impl.file == NULL)
+            {
+                utility::LogError("[PCDStreamWriter] Unable to open file: %s\n", filename.c_str());
+                impl_.reset(new Impl);
+                return false;
+            }
+            if (!WritePCDHeader(impl.file, impl.header, true))
+            {
+                utility::LogError("[PCDStreamWriter] Unable to write header.\n");
+                impl_.reset(new Impl);
+                return false;
+            }
+            return true;
+        }
+
+        bool PCDStreamWriter::Close()
+        {
+            Impl &impl = *impl_;
+            if (impl.file == NULL)
+            {
+                return false;
+            }
+            bool ok = !impl.failed;
+            impl.header.width = (int)impl.points;
+            impl.header.points = (int)impl.points;
+            if (ok && impl.header.datatype == PCD_DATA_BINARY_COMPRESSED)
+            {
+                ok = impl.WriteCompressed();
+            }
+            else if (ok)
+            {
+                // The fixed-width header is overwritten in place.
+                ok = fseek(impl.file, 0, SEEK_SET) == 0 &&
+                     WritePCDHeader(impl.file, impl.header, true);
+            }
+            long file_bytes = ftell(impl.file);
+            ok = fclose(impl.file) == 0 && ok;
+            impl.file = NULL;
+            IOStats *stats = impl.params.stats;
+            if (stats != NULL)
+            {
+                stats->points = impl.points;
+                stats->file_bytes = file_bytes < 0 ? 0 : (size_t)file_bytes;
+                stats->bytes_per_point =
+                    impl.points > 0 ? (double)stats->file_bytes / impl.points : 0.0;
+                stats->total_seconds = stats->io_seconds + stats->header_seconds +
+                                       stats->compression_seconds + stats->conversion_seconds;
+            }
+            impl_.reset(new Impl);
+            return ok;
+        }
+
+        bool PCDStreamWriter::IsOpen() const { return impl_->file != NULL; }
+
+        size_t PCDStreamWriter::PointsWritten() const { return impl_->points; }
+
+        bool PCDStreamWriter::Append(const geometry::PointCloud &batch)
+        {
+            return impl_->Append(batch);
+        }
+
+        bool PCDStreamWriter::Append(const geometry::PointCloudSoA &batch)
+        {
+            return impl_->Append(batch);
+        }
+
+        bool PCDStreamWriter::Append(const geometry::PointCloudSoAd &batch)
+        {
+            return impl_->Append(batch);
+        }
+    } // namespace io
+} // namespace pcd
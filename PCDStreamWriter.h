@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "PointCloud.h"
+#include "PointCloudIO.h"
+#include "PointCloudSoA.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        /// \class PCDStreamWriter
+        ///
+        /// \brief Writes a PCD file from point batches appended over time.
+        ///
+        /// Open() writes a header whose WIDTH and POINTS are fixed-width
+        /// placeholders, Append() writes every batch as it arrives, and Close()
+        /// patches the final point count into the header. ascii and binary data
+        /// go straight to the file. binary_compressed data is staged per field in
+        /// temporary files and compressed block by block on Close(), so memory
+        /// stays bounded by the batch and the compression block size.
+        class PCDIO_EXPORTS PCDStreamWriter
+        {
+        public:
+            PCDStreamWriter();
+            /// Closes the file if it is still open.
+            ~PCDStreamWriter();
+            PCDStreamWriter(const PCDStreamWriter &) = delete;
+            PCDStreamWriter &operator=(const PCDStreamWriter &) = delete;
+
+        public:
+            /// \brief Creates \p filename for points carrying the given attributes.
+            ///
+            /// \param params Data format, compression and threading options.
+            bool Open(const std::string &filename,
+                      bool has_intensitys,
+                      bool has_normals,
+                      bool has_colors,
+                      const WritePointCloudOption &params = WritePointCloudOption());
+            /// \brief Finishes the data and patches the point count into the header.
+            bool Close();
+            bool IsOpen() const;
+
+            /// Number of points appended so far.
+            size_t PointsWritten() const;
+
+            /// \brief Appends the points of \p batch. \p batch must carry every
+            /// attribute given to Open().
+            bool Append(const geometry::PointCloud &batch);
+            bool Append(const geometry::PointCloudSoA &batch);
+            bool Append(const geometry::PointCloudSoAd &batch);
+
+        private:
+            struct Impl;
+            std::unique_ptr<Impl> impl_;
+        };
+    } // namespace io
+} // namespace pcd
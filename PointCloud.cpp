@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <numeric>
 
+#include "Logging.h"
+
 namespace pcd
 {
     namespace geometry
@@ -25,6 +27,8 @@ namespace pcd
             return *this;
         }
 
+        PointCloud &PointCloud::Reset() { return Clear(); }
+
         bool PointCloud::IsEmpty() const { return !HasPoints(); }
 
         Eigen::Vector3d PointCloud::GetMinBound() const
@@ -167,9 +171,8 @@ namespace pcd
             if (has_covariance)
                 covariances_.resize(k);
 
-            fprintf(stderr,
-                    "[RemoveNonFinitePoints] %d nan points have been removed.\n",
-                    (int)(old_point_num - k));
+            utility::LogDebug("[RemoveNonFinitePoints] %d nan points have been removed.\n",
+                              (int)(old_point_num - k));
 
             return *this;
         }
@@ -205,9 +208,8 @@ namespace pcd
                 }
             }
 
-            fprintf(stderr,
-                    "Pointcloud down sampled from %d points to %d points.\n",
-                    (int)points_.size(), (int)output->points_.size());
+            utility::LogDebug("Pointcloud down sampled from %d points to %d points.\n",
+                              (int)points_.size(), (int)output->points_.size());
 
             return output;
         }
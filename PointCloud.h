@@ -41,6 +41,9 @@ namespace pcd
 
                 public:
                         PointCloud &Clear() override;
+                        /// \brief Same as Clear(), which keeps the capacity of every
+                        /// attribute; named for code that recycles clouds between frames.
+                        PointCloud &Reset();
                         bool IsEmpty() const override;
                         Eigen::Vector3d GetMinBound() const override;
                         Eigen::Vector3d GetMaxBound() const override;
@@ -58,10 +61,10 @@ namespace pcd
                         /// Returns 'true' if the point cloud contains points.
                         bool HasPoints() const { return points_.size() > 0; }
 
-                        /// Returns `true` if the point cloud contains point normals.
+                        /// Returns `true` if the point cloud contains point intensities.
                         bool HasIntensitys() const
                         {
-                                return points_.size() > 0 && intensitys_.size() == intensitys_.size();
+                                return points_.size() > 0 && intensitys_.size() == points_.size();
                         }
 
                         /// Returns `true` if the point cloud contains point normals.
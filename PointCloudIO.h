@@ -6,12 +6,50 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <vector>
+#include "BlockCodec.h"
+#include "PCDIOContext.h"
 #include "PointCloud.h"
+#include "PointCloudSoA.h"
 
 namespace pcd
 {
     namespace io
     {
+        /// \struct IOStats
+        /// \brief Timings and counters of one PCD read or write, for monitoring.
+        ///
+        /// Times are wall-clock seconds. Reads map the file, so page faults on the
+        /// data are charged to the stage that first touches it.
+        struct IOStats
+        {
+            /// Points read or written.
+            size_t points = 0;
+            /// Size of the file, header included.
+            size_t file_bytes = 0;
+            /// Size of the data section: text for ascii, records for binary and
+            /// the uncompressed stripes for binary_compressed.
+            size_t data_bytes = 0;
+            /// file_bytes / points.
+            double bytes_per_point = 0.0;
+            /// Uncompressed over compressed data size, 1 for uncompressed data.
+            double compression_ratio = 1.0;
+            /// Opening and mapping the file when reading, writing the data and
+            /// closing the file when writing.
+            double io_seconds = 0.0;
+            /// Parsing the header, or generating and writing it.
+            double header_seconds = 0.0;
+            /// Decompression or compression with the block codec of the file,
+            /// lzf, lz4 or store.
+            double compression_seconds = 0.0;
+            /// Converting values between the file and the cloud, ascii parsing and
+            /// formatting included.
+            double conversion_seconds = 0.0;
+            /// The whole call.
+            double total_seconds = 0.0;
+        };
+
         /// \struct WritePointCloudOption
         /// \brief Optional parameters to WritePointCloud
         struct WritePointCloudOption
@@ -26,6 +64,33 @@ namespace pcd
                 Uncompressed = false,
                 Compressed = true
             };
+            /// Speed against size trade-off of the compression codec. The level
+            /// is not recorded: lzf output at any level is readable by any LZF
+            /// decoder, lz4 output by any LZ4 block decoder, and store ignores it.
+            enum class CompressionLevel : int
+            {
+                /// Smaller hash table, skips quickly over incompressible data.
+                Fast = CODEC_LEVEL_FAST,
+                Default = CODEC_LEVEL_DEFAULT,
+                /// Searches harder for matches that reach further.
+                Best = CODEC_LEVEL_BEST
+            };
+            /// Reversible transform applied to every field stripe of
+            /// binary_compressed data before compression. Filtered files name the filter
+            /// in the header; readers other than this library decompress them
+            /// without error but decode garbage, so filters are opt-in.
+            enum class CompressionFilter : int
+            {
+                None = 0,
+                /// Groups byte b of every element together (Blosc-style shuffle),
+                /// so that the slowly changing high bytes of floats form runs.
+                Shuffle = 1,
+                /// Stores the difference of consecutive elements, then shuffles.
+                /// Suits smoothly varying values such as ordered scans.
+                DeltaShuffle = 2,
+                /// Stores the XOR of consecutive elements, then shuffles.
+                XorShuffle = 3
+            };
             WritePointCloudOption(
                 // Attention: when you update the defaults, update the docstrings in
                 // pybind/io/class_io.cpp
@@ -66,12 +131,53 @@ namespace pcd
             /// completion (0.-100.) return true indicates to continue loading, false
             /// means to try to stop loading and cleanup
             std::function<bool(double)> update_progress;
+            /// Number of threads used for compression, 0 means one per hardware
+            /// thread.
+            int num_threads = 0;
+            /// Size in bytes of the blocks that are compressed independently. Every
+            /// block restarts the back-reference window of the codec, so with lzf
+            /// the concatenated blocks still form one stream readable by any LZF
+            /// decoder.
+            unsigned int compression_block_size = 1 << 22;
+            /// Compression level of binary_compressed data.
+            CompressionLevel compression_level = CompressionLevel::Default;
+            /// Name of the BlockCodec of binary_compressed data: "lzf", the only
+            /// codec PCL reads, "lz4" for faster reads and writes, "store" for no
+            /// compression, or a codec added with RegisterBlockCodec(). Other
+            /// codecs than "lzf" are recorded in the header.
+            std::string compression_codec = "lzf";
+            /// \brief Stores x, y and z of binary and binary_compressed data as
+            /// integers in steps of this size, e.g. 0.001 for millimetre sensors.
+            ///
+            /// Every value is rounded to the nearest step. The scale and offset
+            /// of each axis are recorded in the header, and readers of this
+            /// library dequantize transparently; other readers see the raw
+            /// integers. Axes whose extent fits 65535 steps take 16-bit integers,
+            /// the others 32-bit ones. 0 keeps 32-bit floats. PCDStreamWriter
+            /// ignores it, since the extent is not known up front.
+            double quantization_step = 0;
+            /// Filter of binary_compressed stripes. PCDStreamWriter ignores it,
+            /// since shuffling needs whole stripes.
+            CompressionFilter compression_filter = CompressionFilter::None;
+            /// Filled with timings and counters of the write when not NULL.
+            IOStats *stats = nullptr;
+            /// Buffers reused across writes when not NULL, see PCDIOContext.
+            PCDIOContext *context = nullptr;
         };
 
         /// \struct ReadPointCloudOption
         /// \brief Optional parameters to ReadPointCloud
         struct ReadPointCloudOption
         {
+            /// Point attributes that can be selected with \p fields.
+            enum Field : unsigned int
+            {
+                XYZ = 1 << 0,
+                Normals = 1 << 1,
+                Colors = 1 << 2,
+                Intensity = 1 << 3,
+                All = XYZ | Normals | Colors | Intensity
+            };
             ReadPointCloudOption(
                 // Attention: when you update the defaults, update the docstrings in
                 // pybind/io/class_io.cpp
@@ -105,13 +211,70 @@ namespace pcd
             /// completion (0.-100.) return true indicates to continue loading, false
             /// means to try to stop loading and cleanup
             std::function<bool(double)> update_progress;
+            /// Attributes to load, a combination of Field values. Points are
+            /// always loaded; the fields of other attributes are skipped without
+            /// being decoded.
+            unsigned int fields = All;
+            /// Filled with timings and counters of the read when not NULL.
+            IOStats *stats = nullptr;
+            /// Buffers reused across reads when not NULL, see PCDIOContext.
+            /// ReadPointCloudsFromPCD and PCDSequenceReader ignore it, since they
+            /// decode several files at once.
+            PCDIOContext *context = nullptr;
         };
 
         PCDIO_EXPORTS bool ReadPointCloudFromPCD(const std::string &filename,
                                                  geometry::PointCloud &pointcloud);
 
+        /// Reads the attributes selected by \p params and drops non-finite
+        /// points if requested.
+        PCDIO_EXPORTS bool ReadPointCloudFromPCD(const std::string &filename,
+                                                 geometry::PointCloud &pointcloud,
+                                                 const ReadPointCloudOption &params);
+
+        /// Reads a PCD file straight into single precision columns.
+        PCDIO_EXPORTS bool ReadPointCloudFromPCD(const std::string &filename,
+                                                 geometry::PointCloudSoA &pointcloud);
+        PCDIO_EXPORTS bool ReadPointCloudFromPCD(const std::string &filename,
+                                                 geometry::PointCloudSoA &pointcloud,
+                                                 const ReadPointCloudOption &params);
+
+        /// Reads a PCD file straight into double precision columns.
+        PCDIO_EXPORTS bool ReadPointCloudFromPCD(const std::string &filename,
+                                                 geometry::PointCloudSoAd &pointcloud);
+        PCDIO_EXPORTS bool ReadPointCloudFromPCD(const std::string &filename,
+                                                 geometry::PointCloudSoAd &pointcloud,
+                                                 const ReadPointCloudOption &params);
+
+        /// \brief Reads many PCD files, decoding them in parallel.
+        ///
+        /// Files are read through io_uring where the kernel allows it and with
+        /// `pread` on the thread pool otherwise. \p pointclouds[i] receives
+        /// \p filenames[i], and is left empty if that file cannot be loaded.
+        /// Returns `true` if every file was loaded. The `stats` of \p params
+        /// are not filled.
+        PCDIO_EXPORTS bool ReadPointCloudsFromPCD(const std::vector<std::string> &filenames,
+                                                  std::vector<geometry::PointCloud> &pointclouds,
+                                                  const ReadPointCloudOption &params = ReadPointCloudOption());
+        PCDIO_EXPORTS bool ReadPointCloudsFromPCD(const std::vector<std::string> &filenames,
+                                                  std::vector<geometry::PointCloudSoA> &pointclouds,
+                                                  const ReadPointCloudOption &params = ReadPointCloudOption());
+        PCDIO_EXPORTS bool ReadPointCloudsFromPCD(const std::vector<std::string> &filenames,
+                                                  std::vector<geometry::PointCloudSoAd> &pointclouds,
+                                                  const ReadPointCloudOption &params = ReadPointCloudOption());
+
         PCDIO_EXPORTS bool WritePointCloudToPCD(const std::string &filename,
                                                 const geometry::PointCloud &pointcloud,
                                                 const WritePointCloudOption &params);
+
+        /// Writes single precision columns straight to a PCD file.
+        PCDIO_EXPORTS bool WritePointCloudToPCD(const std::string &filename,
+                                                const geometry::PointCloudSoA &pointcloud,
+                                                const WritePointCloudOption &params);
+
+        /// Writes double precision columns straight to a PCD file.
+        PCDIO_EXPORTS bool WritePointCloudToPCD(const std::string &filename,
+                                                const geometry::PointCloudSoAd &pointcloud,
+                                                const WritePointCloudOption &params);
     }
 }
\ No newline at end of file
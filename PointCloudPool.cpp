@@ -0,0 +1,98 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+
+#include "PointCloudPool.h"
+
+#include <mutex>
+#include <vector>
+
+namespace pcd
+{
+    namespace geometry
+    {
+        template <typename PointCloudT>
+        struct BasicPointCloudPool<PointCloudT>::State
+        {
+            std::mutex mutex;
+            // reserved up front, so releasing never allocates
+            std::vector<std::unique_ptr<PointCloudT>> idle;
+            size_t max_idle = 0;
+        };
+
+        template <typename PointCloudT>
+        void BasicPointCloudPool<PointCloudT>::Releaser::operator()(PointCloudT *cloud) const
+        {
+            std::unique_ptr<PointCloudT> owned(cloud);
+            if (state == nullptr || owned == nullptr)
+            {
+                return;
+            }
+            owned->Reset();
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->idle.size() < state->max_idle)
+            {
+                state->idle.push_back(std::move(owned));
+            }
+        }
+
+        template <typename PointCloudT>
+        BasicPointCloudPool<PointCloudT>::BasicPointCloudPool(size_t max_idle)
+            : state_(std::make_shared<State>())
+        {
+            state_->max_idle = max_idle;
+            state_->idle.reserve(max_idle);
+        }
+
+        template <typename PointCloudT>
+        BasicPointCloudPool<PointCloudT>::~BasicPointCloudPool()
+        {
+            // Handles still out keep the state alive, so free the idle clouds now
+            // and let later releases free theirs.
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->idle.clear();
+            state_->max_idle = 0;
+        }
+
+        template <typename PointCloudT>
+        typename BasicPointCloudPool<PointCloudT>::Handle
+        BasicPointCloudPool<PointCloudT>::Acquire()
+        {
+            std::unique_ptr<PointCloudT> cloud;
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                if (!state_->idle.empty())
+                {
+                    cloud = std::move(state_->idle.back());
+                    state_->idle.pop_back();
+                }
+            }
+            if (cloud == nullptr)
+            {
+                cloud.reset(new PointCloudT);
+            }
+            return Handle(cloud.release(), Releaser{state_});
+        }
+
+        template <typename PointCloudT>
+        size_t BasicPointCloudPool<PointCloudT>::NumIdle() const
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            return state_->idle.size();
+        }
+
+        template <typename PointCloudT>
+        void BasicPointCloudPool<PointCloudT>::Trim()
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->idle.clear();
+        }
+
+        template class BasicPointCloudPool<PointCloud>;
+        template class BasicPointCloudPool<PointCloudSoA>;
+        template class BasicPointCloudPool<PointCloudSoAd>;
+
+    } // namespace geometry
+} // namespace pcd
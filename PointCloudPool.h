@@ -0,0 +1,76 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory>
+
+#include "PointCloud.h"
+#include "PointCloudSoA.h"
+
+namespace pcd
+{
+        namespace geometry
+        {
+
+                /// \class BasicPointCloudPool
+                ///
+                /// \brief Recycles point clouds between frames of a stream.
+                ///
+                /// Acquire() hands out an empty cloud that keeps the storage of a
+                /// cloud released earlier. Once the clouds in flight have grown to
+                /// the frame size, reading frames into acquired clouds allocates no
+                /// point storage; pass a PCDIOContext to the reads as well to also
+                /// reuse the decoding buffers. Handles may outlive the pool, their
+                /// clouds are then freed. The pool is thread-safe.
+                template <typename PointCloudT>
+                class PCDIO_EXPORTS BasicPointCloudPool
+                {
+                private:
+                        struct State;
+
+                public:
+                        /// Returns a cloud to its pool, or frees it if the pool is full
+                        /// or gone.
+                        struct Releaser
+                        {
+                                std::shared_ptr<State> state;
+                                void operator()(PointCloudT *cloud) const;
+                        };
+                        /// Owner of an acquired cloud.
+                        typedef std::unique_ptr<PointCloudT, Releaser> Handle;
+
+                public:
+                        /// \param max_idle Number of released clouds kept for reuse;
+                        /// further released clouds are freed.
+                        explicit BasicPointCloudPool(size_t max_idle = 8);
+                        ~BasicPointCloudPool();
+                        BasicPointCloudPool(const BasicPointCloudPool &) = delete;
+                        BasicPointCloudPool &operator=(const BasicPointCloudPool &) = delete;
+
+                public:
+                        /// \brief Returns an empty cloud, reusing a released one when
+                        /// available. It goes back to the pool when \p Handle drops it.
+                        Handle Acquire();
+                        /// Number of released clouds waiting for reuse.
+                        size_t NumIdle() const;
+                        /// Frees the released clouds.
+                        void Trim();
+
+                private:
+                        std::shared_ptr<State> state_;
+                };
+
+                extern template class BasicPointCloudPool<PointCloud>;
+                extern template class BasicPointCloudPool<PointCloudSoA>;
+                extern template class BasicPointCloudPool<PointCloudSoAd>;
+
+                typedef BasicPointCloudPool<PointCloud> PointCloudPool;
+                typedef BasicPointCloudPool<PointCloudSoA> PointCloudSoAPool;
+                typedef BasicPointCloudPool<PointCloudSoAd> PointCloudSoAdPool;
+
+        } // namespace geometry
+} // namespace pcd
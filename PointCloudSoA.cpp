@@ -0,0 +1,307 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+
+#include "PointCloudSoA.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "PointCloud.h"
+#include "Logging.h"
+
+namespace pcd
+{
+    namespace geometry
+    {
+        namespace
+        {
+            std::uint32_t PackColor(const Eigen::Vector3d &color)
+            {
+                std::uint32_t rgb[3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    rgb[i] = std::uint32_t(
+                        std::round(std::min(1., std::max(0., color(i))) * 255.));
+                }
+                return (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+            }
+
+            Eigen::Vector3d UnpackColor(std::uint32_t packed)
+            {
+                return Eigen::Vector3d((packed >> 16) & 0xff, (packed >> 8) & 0xff,
+                                       packed & 0xff) /
+                       255.0;
+            }
+        } // unnamed namespace
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Clear()
+        {
+            return Resize(0, false, false, false);
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Reset()
+        {
+            return Clear();
+        }
+
+        template <typename Scalar>
+        bool BasicPointCloudSoA<Scalar>::IsEmpty() const { return !HasPoints(); }
+
+        template <typename Scalar>
+        Eigen::Vector3d BasicPointCloudSoA<Scalar>::GetMinBound() const
+        {
+            if (!HasPoints())
+            {
+                return Eigen::Vector3d(0.0, 0.0, 0.0);
+            }
+            return Eigen::Vector3d(*std::min_element(x_.begin(), x_.end()),
+                                   *std::min_element(y_.begin(), y_.end()),
+                                   *std::min_element(z_.begin(), z_.end()));
+        }
+
+        template <typename Scalar>
+        Eigen::Vector3d BasicPointCloudSoA<Scalar>::GetMaxBound() const
+        {
+            if (!HasPoints())
+            {
+                return Eigen::Vector3d(0.0, 0.0, 0.0);
+            }
+            return Eigen::Vector3d(*std::max_element(x_.begin(), x_.end()),
+                                   *std::max_element(y_.begin(), y_.end()),
+                                   *std::max_element(z_.begin(), z_.end()));
+        }
+
+        template <typename Scalar>
+        Eigen::Vector3d BasicPointCloudSoA<Scalar>::GetCenter() const
+        {
+            Eigen::Vector3d center(0, 0, 0);
+            if (!HasPoints())
+            {
+                return center;
+            }
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                center(0) += x_[i];
+                center(1) += y_[i];
+                center(2) += z_[i];
+            }
+            center /= double(x_.size());
+            return center;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Transform(
+            const Eigen::Matrix4d &transformation)
+        {
+            const Eigen::Matrix<Scalar, 4, 4> t = transformation.cast<Scalar>();
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                Scalar x = x_[i], y = y_[i], z = z_[i];
+                Scalar w = t(3, 0) * x + t(3, 1) * y + t(3, 2) * z + t(3, 3);
+                x_[i] = (t(0, 0) * x + t(0, 1) * y + t(0, 2) * z + t(0, 3)) / w;
+                y_[i] = (t(1, 0) * x + t(1, 1) * y + t(1, 2) * z + t(1, 3)) / w;
+                z_[i] = (t(2, 0) * x + t(2, 1) * y + t(2, 2) * z + t(2, 3)) / w;
+            }
+            for (size_t i = 0; i < normal_x_.size(); i++)
+            {
+                Scalar x = normal_x_[i], y = normal_y_[i], z = normal_z_[i];
+                normal_x_[i] = t(0, 0) * x + t(0, 1) * y + t(0, 2) * z;
+                normal_y_[i] = t(1, 0) * x + t(1, 1) * y + t(1, 2) * z;
+                normal_z_[i] = t(2, 0) * x + t(2, 1) * y + t(2, 2) * z;
+            }
+            return *this;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Translate(
+            const Eigen::Vector3d &translation, bool relative)
+        {
+            Eigen::Vector3d transform = translation;
+            if (!relative)
+            {
+                transform -= GetCenter();
+            }
+            const Scalar tx = Scalar(transform(0));
+            const Scalar ty = Scalar(transform(1));
+            const Scalar tz = Scalar(transform(2));
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                x_[i] += tx;
+                y_[i] += ty;
+                z_[i] += tz;
+            }
+            return *this;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Scale(
+            const double scale, const Eigen::Vector3d &center)
+        {
+            const Scalar s = Scalar(scale);
+            const Scalar cx = Scalar(center(0));
+            const Scalar cy = Scalar(center(1));
+            const Scalar cz = Scalar(center(2));
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                x_[i] = (x_[i] - cx) * s + cx;
+                y_[i] = (y_[i] - cy) * s + cy;
+                z_[i] = (z_[i] - cz) * s + cz;
+            }
+            return *this;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Rotate(
+            const Eigen::Matrix3d &R, const Eigen::Vector3d &center)
+        {
+            const Eigen::Matrix<Scalar, 3, 3> r = R.cast<Scalar>();
+            const Scalar cx = Scalar(center(0));
+            const Scalar cy = Scalar(center(1));
+            const Scalar cz = Scalar(center(2));
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                Scalar x = x_[i] - cx, y = y_[i] - cy, z = z_[i] - cz;
+                x_[i] = r(0, 0) * x + r(0, 1) * y + r(0, 2) * z + cx;
+                y_[i] = r(1, 0) * x + r(1, 1) * y + r(1, 2) * z + cy;
+                z_[i] = r(2, 0) * x + r(2, 1) * y + r(2, 2) * z + cz;
+            }
+            for (size_t i = 0; i < normal_x_.size(); i++)
+            {
+                Scalar x = normal_x_[i], y = normal_y_[i], z = normal_z_[i];
+                normal_x_[i] = r(0, 0) * x + r(0, 1) * y + r(0, 2) * z;
+                normal_y_[i] = r(1, 0) * x + r(1, 1) * y + r(1, 2) * z;
+                normal_z_[i] = r(2, 0) * x + r(2, 1) * y + r(2, 2) * z;
+            }
+            return *this;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::Resize(
+            size_t size, bool has_intensitys, bool has_normals, bool has_colors)
+        {
+            x_.resize(size);
+            y_.resize(size);
+            z_.resize(size);
+            intensity_.resize(has_intensitys ? size : 0);
+            normal_x_.resize(has_normals ? size : 0);
+            normal_y_.resize(has_normals ? size : 0);
+            normal_z_.resize(has_normals ? size : 0);
+            rgb_.resize(has_colors ? size : 0);
+            return *this;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::RemoveNonFinitePoints(
+            bool remove_nan, bool remove_infinite)
+        {
+            bool has_intensity = HasIntensitys();
+            bool has_normal = HasNormals();
+            bool has_color = HasColors();
+            size_t old_point_num = x_.size();
+            size_t k = 0; // new index
+            for (size_t i = 0; i < old_point_num; i++)
+            { // old index
+                bool is_nan = remove_nan &&
+                              (std::isnan(x_[i]) || std::isnan(y_[i]) || std::isnan(z_[i]));
+                bool is_infinite = remove_infinite &&
+                                   (std::isinf(x_[i]) || std::isinf(y_[i]) || std::isinf(z_[i]));
+                if (!is_nan && !is_infinite)
+                {
+                    x_[k] = x_[i];
+                    y_[k] = y_[i];
+                    z_[k] = z_[i];
+                    if (has_intensity)
+                        intensity_[k] = intensity_[i];
+                    if (has_normal)
+                    {
+                        normal_x_[k] = normal_x_[i];
+                        normal_y_[k] = normal_y_[i];
+                        normal_z_[k] = normal_z_[i];
+                    }
+                    if (has_color)
+                        rgb_[k] = rgb_[i];
+                    k++;
+                }
+            }
+            Resize(k, has_intensity, has_normal, has_color);
+
+            utility::LogDebug("[RemoveNonFinitePoints] %d nan points have been removed.\n",
+                              (int)(old_point_num - k));
+
+            return *this;
+        }
+
+        template <typename Scalar>
+        BasicPointCloudSoA<Scalar> &BasicPointCloudSoA<Scalar>::FromPointCloud(
+            const PointCloud &cloud)
+        {
+            const size_t size = cloud.points_.size();
+            Resize(size, cloud.HasIntensitys(), cloud.HasNormals(), cloud.HasColors());
+            for (size_t i = 0; i < size; i++)
+            {
+                x_[i] = Scalar(cloud.points_[i](0));
+                y_[i] = Scalar(cloud.points_[i](1));
+                z_[i] = Scalar(cloud.points_[i](2));
+            }
+            for (size_t i = 0; i < intensity_.size(); i++)
+            {
+                intensity_[i] = Scalar(cloud.intensitys_[i]);
+            }
+            for (size_t i = 0; i < normal_x_.size(); i++)
+            {
+                normal_x_[i] = Scalar(cloud.normals_[i](0));
+                normal_y_[i] = Scalar(cloud.normals_[i](1));
+                normal_z_[i] = Scalar(cloud.normals_[i](2));
+            }
+            for (size_t i = 0; i < rgb_.size(); i++)
+            {
+                rgb_[i] = PackColor(cloud.colors_[i]);
+            }
+            return *this;
+        }
+
+        template <typename Scalar>
+        std::shared_ptr<PointCloud> BasicPointCloudSoA<Scalar>::ToPointCloud() const
+        {
+            auto output = std::make_shared<PointCloud>();
+            const size_t size = x_.size();
+            output->points_.resize(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                output->points_[i] = Eigen::Vector3d(x_[i], y_[i], z_[i]);
+            }
+            if (HasIntensitys())
+            {
+                output->intensitys_.assign(intensity_.begin(), intensity_.end());
+            }
+            if (HasNormals())
+            {
+                output->normals_.resize(size);
+                for (size_t i = 0; i < size; i++)
+                {
+                    output->normals_[i] =
+                        Eigen::Vector3d(normal_x_[i], normal_y_[i], normal_z_[i]);
+                }
+            }
+            if (HasColors())
+            {
+                output->colors_.resize(size);
+                for (size_t i = 0; i < size; i++)
+                {
+                    output->colors_[i] = UnpackColor(rgb_[i]);
+                }
+            }
+            return output;
+        }
+
+        template class BasicPointCloudSoA<float>;
+        template class BasicPointCloudSoA<double>;
+
+    } // namespace geometry
+} // namespace pcd
@@ -0,0 +1,141 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <Eigen/Core>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "Geometry3D.h"
+
+namespace pcd
+{
+        namespace geometry
+        {
+
+                class PointCloud;
+
+                /// \class BasicPointCloudSoA
+                ///
+                /// \brief A point cloud stored as a structure of arrays.
+                ///
+                /// Every attribute lives in its own 64-byte aligned column of \p Scalar,
+                /// which matches the float fields of PCD files one to one and keeps
+                /// per-attribute loops contiguous. Colors are kept as packed PCL words
+                /// (0x00RRGGBB), exactly as they are stored in the rgb field.
+                template <typename Scalar>
+                class PCDIO_EXPORTS BasicPointCloudSoA : public Geometry3D
+                {
+                public:
+                        typedef std::vector<Scalar, AlignedAllocator<Scalar>> Column;
+                        typedef std::vector<std::uint32_t, AlignedAllocator<std::uint32_t>>
+                            PackedColumn;
+
+                public:
+                        /// \brief Default Constructor.
+                        BasicPointCloudSoA()
+                            : Geometry3D(Geometry::GeometryType::PointCloudSoA) {}
+                        /// \brief Converting Constructor.
+                        ///
+                        /// \param cloud Point cloud whose attributes are copied.
+                        explicit BasicPointCloudSoA(const PointCloud &cloud)
+                            : Geometry3D(Geometry::GeometryType::PointCloudSoA)
+                        {
+                                FromPointCloud(cloud);
+                        }
+                        ~BasicPointCloudSoA() override {}
+
+                public:
+                        BasicPointCloudSoA &Clear() override;
+                        /// \brief Same as Clear(), which keeps the capacity of every
+                        /// column; named for code that recycles clouds between frames.
+                        BasicPointCloudSoA &Reset();
+                        bool IsEmpty() const override;
+                        Eigen::Vector3d GetMinBound() const override;
+                        Eigen::Vector3d GetMaxBound() const override;
+                        Eigen::Vector3d GetCenter() const override;
+                        BasicPointCloudSoA &Transform(const Eigen::Matrix4d &transformation) override;
+                        BasicPointCloudSoA &Translate(const Eigen::Vector3d &translation,
+                                                      bool relative = true) override;
+                        BasicPointCloudSoA &Scale(const double scale,
+                                                  const Eigen::Vector3d &center) override;
+                        BasicPointCloudSoA &Rotate(const Eigen::Matrix3d &R,
+                                                   const Eigen::Vector3d &center) override;
+
+                        /// Number of points.
+                        size_t Size() const { return x_.size(); }
+
+                        /// Returns 'true' if the point cloud contains points.
+                        bool HasPoints() const { return x_.size() > 0; }
+
+                        /// Returns `true` if the point cloud contains point intensities.
+                        bool HasIntensitys() const
+                        {
+                                return x_.size() > 0 && intensity_.size() == x_.size();
+                        }
+
+                        /// Returns `true` if the point cloud contains point normals.
+                        bool HasNormals() const
+                        {
+                                return x_.size() > 0 && normal_x_.size() == x_.size();
+                        }
+
+                        /// Returns `true` if the point cloud contains point colors.
+                        bool HasColors() const
+                        {
+                                return x_.size() > 0 && rgb_.size() == x_.size();
+                        }
+
+                        /// \brief Resizes the point columns to \p size and the optional
+                        /// columns to either \p size or 0.
+                        BasicPointCloudSoA &Resize(size_t size,
+                                                   bool has_intensitys,
+                                                   bool has_normals,
+                                                   bool has_colors);
+
+                        /// \brief Removes the points that have a nan or infinite
+                        /// coordinate, together with their attributes.
+                        ///
+                        /// \param remove_nan Remove NaN values from the point cloud.
+                        /// \param remove_infinite Remove infinite values from the point cloud.
+                        BasicPointCloudSoA &RemoveNonFinitePoints(bool remove_nan = true,
+                                                                  bool remove_infinite = true);
+
+                        /// \brief Replaces the contents with the attributes of \p cloud.
+                        BasicPointCloudSoA &FromPointCloud(const PointCloud &cloud);
+
+                        /// \brief Returns the contents as an array-of-structures
+                        /// PointCloud.
+                        std::shared_ptr<PointCloud> ToPointCloud() const;
+
+                public:
+                        /// Point coordinates.
+                        Column x_;
+                        Column y_;
+                        Column z_;
+                        /// Point intensities.
+                        Column intensity_;
+                        /// Point normals.
+                        Column normal_x_;
+                        Column normal_y_;
+                        Column normal_z_;
+                        /// Packed point colors.
+                        PackedColumn rgb_;
+                };
+
+                extern template class BasicPointCloudSoA<float>;
+                extern template class BasicPointCloudSoA<double>;
+
+                /// Single precision SoA point cloud, the native layout of PCD files.
+                typedef BasicPointCloudSoA<float> PointCloudSoA;
+                /// Double precision SoA point cloud.
+                typedef BasicPointCloudSoA<double> PointCloudSoAd;
+
+        } // namespace geometry
+} // namespace pcd
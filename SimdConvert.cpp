@@ -0,0 +1,782 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "SimdConvert.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <string.h>
+
+#include "Logging.h"
+
+#if !defined(PCDIO_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64)
+#define PCDIO_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PCDIO_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+// Compiles a function for an instruction set the build does not enable by
+// default. MSVC accepts every intrinsic without it.
+#if defined(__GNUC__) || defined(__clang__)
+#define PCDIO_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PCDIO_TARGET(isa)
+#endif
+
+namespace pcd
+{
+    namespace io
+    {
+        namespace internal
+        {
+            namespace
+            {
+                template <typename T>
+                inline T LoadScalar(const char *src)
+                {
+                    T value;
+                    memcpy(&value, src, sizeof(value));
+                    return value;
+                }
+
+                template <typename T>
+                inline void StoreScalar(char *dst, T value)
+                {
+                    memcpy(dst, &value, sizeof(value));
+                }
+
+                /// Converts the elements the vector loops leave over.
+                template <typename Src, typename Dst>
+                void ConvertTail(const char *src, size_t src_stride,
+                                 char *dst, size_t dst_stride, size_t count)
+                {
+                    for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                    {
+                        StoreScalar<Dst>(dst, (Dst)LoadScalar<Src>(src));
+                    }
+                }
+
+                /// Copies a column that needs no conversion at all.
+                template <typename Src, typename Dst>
+                bool CopyContiguous(const char *src, size_t src_stride,
+                                    char *dst, size_t dst_stride, size_t count)
+                {
+                    if (std::is_same<Src, Dst>::value && src_stride == sizeof(Src) &&
+                        dst_stride == sizeof(Dst))
+                    {
+                        memcpy(dst, src, count * sizeof(Src));
+                        return true;
+                    }
+                    return false;
+                }
+
+#if defined(PCDIO_SIMD_X86)
+                // Four-lane loads and stores over arbitrary strides. SSE2 is part
+                // of every x86-64 target, so these inline into any kernel.
+                inline __m128 LoadFloat4(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(float))
+                    {
+                        return _mm_loadu_ps(reinterpret_cast<const float *>(src));
+                    }
+                    return _mm_setr_ps(LoadScalar<float>(src), LoadScalar<float>(src + stride),
+                                       LoadScalar<float>(src + 2 * stride),
+                                       LoadScalar<float>(src + 3 * stride));
+                }
+
+                inline void StoreFloat4(char *dst, size_t stride, __m128 value)
+                {
+                    if (stride == sizeof(float))
+                    {
+                        _mm_storeu_ps(reinterpret_cast<float *>(dst), value);
+                        return;
+                    }
+                    // Records are packed, so lanes are stored without alignment.
+                    StoreScalar(dst, _mm_cvtss_f32(value));
+                    StoreScalar(dst + stride, _mm_cvtss_f32(_mm_shuffle_ps(
+                                                  value, value, _MM_SHUFFLE(1, 1, 1, 1))));
+                    StoreScalar(dst + 2 * stride, _mm_cvtss_f32(_mm_movehl_ps(value, value)));
+                    StoreScalar(dst + 3 * stride, _mm_cvtss_f32(_mm_shuffle_ps(
+                                                      value, value, _MM_SHUFFLE(3, 3, 3, 3))));
+                }
+
+                inline __m128d LoadDouble2(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(double))
+                    {
+                        return _mm_loadu_pd(reinterpret_cast<const double *>(src));
+                    }
+                    return _mm_setr_pd(LoadScalar<double>(src), LoadScalar<double>(src + stride));
+                }
+
+                inline void StoreDouble2(char *dst, size_t stride, __m128d value)
+                {
+                    if (stride == sizeof(double))
+                    {
+                        _mm_storeu_pd(reinterpret_cast<double *>(dst), value);
+                        return;
+                    }
+                    StoreScalar(dst, _mm_cvtsd_f64(value));
+                    StoreScalar(dst + stride, _mm_cvtsd_f64(_mm_unpackhi_pd(value, value)));
+                }
+
+                /// Loads four integers of type \p Src widened to 32 bits.
+                template <typename Src>
+                PCDIO_TARGET("sse4.1")
+                inline __m128i LoadInt4(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(Src))
+                    {
+                        if (std::is_same<Src, std::uint8_t>::value)
+                        {
+                            return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(LoadScalar<int>(src)));
+                        }
+                        if (std::is_same<Src, std::int8_t>::value)
+                        {
+                            return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(LoadScalar<int>(src)));
+                        }
+                        if (std::is_same<Src, std::uint16_t>::value)
+                        {
+                            return _mm_cvtepu16_epi32(
+                                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)));
+                        }
+                        if (std::is_same<Src, std::int16_t>::value)
+                        {
+                            return _mm_cvtepi16_epi32(
+                                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)));
+                        }
+                        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+                    }
+                    return _mm_setr_epi32(LoadScalar<Src>(src), LoadScalar<Src>(src + stride),
+                                          LoadScalar<Src>(src + 2 * stride),
+                                          LoadScalar<Src>(src + 3 * stride));
+                }
+
+                /// Converts four elements per step. Every lane conversion rounds
+                /// exactly like the matching C cast.
+                template <typename Src, typename Dst>
+                PCDIO_TARGET("sse4.1")
+                void Sse41Convert(const char *src, size_t src_stride,
+                                  char *dst, size_t dst_stride, size_t count)
+                {
+                    if (CopyContiguous<Src, Dst>(src, src_stride, dst, dst_stride, count))
+                    {
+                        return;
+                    }
+                    size_t i = 0;
+                    for (; i + 4 <= count; i += 4, src += 4 * src_stride, dst += 4 * dst_stride)
+                    {
+                        if constexpr (std::is_same<Src, double>::value)
+                        {
+                            __m128d lo = LoadDouble2(src, src_stride);
+                            __m128d hi = LoadDouble2(src + 2 * src_stride, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                StoreDouble2(dst, dst_stride, lo);
+                                StoreDouble2(dst + 2 * dst_stride, dst_stride, hi);
+                            }
+                            else
+                            {
+                                StoreFloat4(dst, dst_stride,
+                                            _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+                            }
+                        }
+                        else if constexpr (std::is_same<Src, float>::value)
+                        {
+                            __m128 value = LoadFloat4(src, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                StoreDouble2(dst, dst_stride, _mm_cvtps_pd(value));
+                                StoreDouble2(dst + 2 * dst_stride, dst_stride,
+                                             _mm_cvtps_pd(_mm_movehl_ps(value, value)));
+                            }
+                            else
+                            {
+                                StoreFloat4(dst, dst_stride, value);
+                            }
+                        }
+                        else
+                        {
+                            __m128i value = LoadInt4<Src>(src, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                StoreDouble2(dst, dst_stride, _mm_cvtepi32_pd(value));
+                                StoreDouble2(dst + 2 * dst_stride, dst_stride,
+                                             _mm_cvtepi32_pd(_mm_unpackhi_epi64(value, value)));
+                            }
+                            else
+                            {
+                                StoreFloat4(dst, dst_stride, _mm_cvtepi32_ps(value));
+                            }
+                        }
+                    }
+                    ConvertTail<Src, Dst>(src, src_stride, dst, dst_stride, count - i);
+                }
+
+                /// Packed BGR word to an Eigen::Vector3d in [0, 1].
+                PCDIO_TARGET("sse4.1")
+                void Sse41DecodeColor(const char *src, size_t src_stride,
+                                      char *dst, size_t dst_stride, size_t count)
+                {
+                    const __m128d scale = _mm_set1_pd(255.0);
+                    for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                    {
+                        // (b, g, r, a) reordered to (r, g, b, a)
+                        __m128i bgra = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(LoadScalar<int>(src)));
+                        __m128i rgba = _mm_shuffle_epi32(bgra, _MM_SHUFFLE(3, 0, 1, 2));
+                        __m128d rg = _mm_div_pd(_mm_cvtepi32_pd(rgba), scale);
+                        __m128d ba = _mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(rgba, rgba)),
+                                                scale);
+                        _mm_storeu_pd(reinterpret_cast<double *>(dst), rg);
+                        StoreScalar(dst + 2 * sizeof(double), _mm_cvtsd_f64(ba));
+                    }
+                }
+
+                /// Rounds half away from zero, as std::round does for the
+                /// non-negative values produced by the color clamp.
+                PCDIO_TARGET("sse4.1")
+                inline __m128d RoundHalfUp(__m128d value)
+                {
+                    __m128d whole = _mm_round_pd(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                    __m128d carry = _mm_cmpge_pd(_mm_sub_pd(value, whole), _mm_set1_pd(0.5));
+                    return _mm_add_pd(whole, _mm_and_pd(carry, _mm_set1_pd(1.0)));
+                }
+
+                /// Eigen::Vector3d color to a packed BGR word.
+                PCDIO_TARGET("sse4.1")
+                void Sse41EncodeColor(const char *src, size_t src_stride,
+                                      char *dst, size_t dst_stride, size_t count)
+                {
+                    const __m128d zero = _mm_setzero_pd();
+                    const __m128d one = _mm_set1_pd(1.0);
+                    const __m128d scale = _mm_set1_pd(255.0);
+                    for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                    {
+                        // max() returns its second operand for NaN, which maps NaN to
+                        // 0 like the scalar clamp does.
+                        __m128d rg = _mm_loadu_pd(reinterpret_cast<const double *>(src));
+                        __m128d b = _mm_set_sd(LoadScalar<double>(src + 2 * sizeof(double)));
+                        rg = _mm_min_pd(_mm_max_pd(rg, zero), one);
+                        b = _mm_min_pd(_mm_max_pd(b, zero), one);
+                        __m128i rg8 = _mm_cvttpd_epi32(RoundHalfUp(_mm_mul_pd(rg, scale)));
+                        __m128i b8 = _mm_cvttpd_epi32(RoundHalfUp(_mm_mul_pd(b, scale)));
+                        std::uint32_t word = (std::uint32_t)_mm_cvtsi128_si32(b8) |
+                                             ((std::uint32_t)_mm_extract_epi32(rg8, 1) << 8) |
+                                             ((std::uint32_t)_mm_cvtsi128_si32(rg8) << 16);
+                        StoreScalar(dst, word);
+                    }
+                }
+
+                // Eight-lane variants. Strided columns are assembled from the
+                // four-lane helpers above.
+                template <typename Src>
+                PCDIO_TARGET("avx2")
+                inline __m256i LoadInt8(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(Src))
+                    {
+                        const __m128i *ptr = reinterpret_cast<const __m128i *>(src);
+                        if (std::is_same<Src, std::uint8_t>::value)
+                        {
+                            return _mm256_cvtepu8_epi32(_mm_loadl_epi64(ptr));
+                        }
+                        if (std::is_same<Src, std::int8_t>::value)
+                        {
+                            return _mm256_cvtepi8_epi32(_mm_loadl_epi64(ptr));
+                        }
+                        if (std::is_same<Src, std::uint16_t>::value)
+                        {
+                            return _mm256_cvtepu16_epi32(_mm_loadu_si128(ptr));
+                        }
+                        if (std::is_same<Src, std::int16_t>::value)
+                        {
+                            return _mm256_cvtepi16_epi32(_mm_loadu_si128(ptr));
+                        }
+                        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+                    }
+                    return _mm256_set_m128i(LoadInt4<Src>(src + 4 * stride, stride),
+                                            LoadInt4<Src>(src, stride));
+                }
+
+                PCDIO_TARGET("avx2")
+                inline __m256 LoadFloat8(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(float))
+                    {
+                        return _mm256_loadu_ps(reinterpret_cast<const float *>(src));
+                    }
+                    return _mm256_set_m128(LoadFloat4(src + 4 * stride, stride),
+                                           LoadFloat4(src, stride));
+                }
+
+                PCDIO_TARGET("avx2")
+                inline void StoreFloat8(char *dst, size_t stride, __m256 value)
+                {
+                    if (stride == sizeof(float))
+                    {
+                        _mm256_storeu_ps(reinterpret_cast<float *>(dst), value);
+                        return;
+                    }
+                    StoreFloat4(dst, stride, _mm256_castps256_ps128(value));
+                    StoreFloat4(dst + 4 * stride, stride, _mm256_extractf128_ps(value, 1));
+                }
+
+                PCDIO_TARGET("avx2")
+                inline __m256d LoadDouble4(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(double))
+                    {
+                        return _mm256_loadu_pd(reinterpret_cast<const double *>(src));
+                    }
+                    return _mm256_set_m128d(LoadDouble2(src + 2 * stride, stride),
+                                            LoadDouble2(src, stride));
+                }
+
+                PCDIO_TARGET("avx2")
+                inline void StoreDouble4(char *dst, size_t stride, __m256d value)
+                {
+                    if (stride == sizeof(double))
+                    {
+                        _mm256_storeu_pd(reinterpret_cast<double *>(dst), value);
+                        return;
+                    }
+                    StoreDouble2(dst, stride, _mm256_castpd256_pd128(value));
+                    StoreDouble2(dst + 2 * stride, stride, _mm256_extractf128_pd(value, 1));
+                }
+
+                /// Converts eight elements per step.
+                template <typename Src, typename Dst>
+                PCDIO_TARGET("avx2")
+                void Avx2Convert(const char *src, size_t src_stride,
+                                 char *dst, size_t dst_stride, size_t count)
+                {
+                    if (CopyContiguous<Src, Dst>(src, src_stride, dst, dst_stride, count))
+                    {
+                        return;
+                    }
+                    size_t i = 0;
+                    for (; i + 8 <= count; i += 8, src += 8 * src_stride, dst += 8 * dst_stride)
+                    {
+                        if constexpr (std::is_same<Src, double>::value)
+                        {
+                            __m256d lo = LoadDouble4(src, src_stride);
+                            __m256d hi = LoadDouble4(src + 4 * src_stride, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                StoreDouble4(dst, dst_stride, lo);
+                                StoreDouble4(dst + 4 * dst_stride, dst_stride, hi);
+                            }
+                            else
+                            {
+                                StoreFloat8(dst, dst_stride,
+                                            _mm256_set_m128(_mm256_cvtpd_ps(hi),
+                                                            _mm256_cvtpd_ps(lo)));
+                            }
+                        }
+                        else if constexpr (std::is_same<Src, float>::value)
+                        {
+                            __m256 value = LoadFloat8(src, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                StoreDouble4(dst, dst_stride,
+                                             _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+                                StoreDouble4(dst + 4 * dst_stride, dst_stride,
+                                             _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+                            }
+                            else
+                            {
+                                StoreFloat8(dst, dst_stride, value);
+                            }
+                        }
+                        else
+                        {
+                            __m256i value = LoadInt8<Src>(src, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                StoreDouble4(dst, dst_stride,
+                                             _mm256_cvtepi32_pd(_mm256_castsi256_si128(value)));
+                                StoreDouble4(dst + 4 * dst_stride, dst_stride,
+                                             _mm256_cvtepi32_pd(_mm256_extracti128_si256(value, 1)));
+                            }
+                            else
+                            {
+                                StoreFloat8(dst, dst_stride, _mm256_cvtepi32_ps(value));
+                            }
+                        }
+                    }
+                    ConvertTail<Src, Dst>(src, src_stride, dst, dst_stride, count - i);
+                }
+#endif // PCDIO_SIMD_X86
+
+#if defined(PCDIO_SIMD_NEON)
+                inline float32x4_t NeonLoadFloat4(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(float))
+                    {
+                        return vld1q_f32(reinterpret_cast<const float *>(src));
+                    }
+                    float lanes[4] = {LoadScalar<float>(src), LoadScalar<float>(src + stride),
+                                      LoadScalar<float>(src + 2 * stride),
+                                      LoadScalar<float>(src + 3 * stride)};
+                    return vld1q_f32(lanes);
+                }
+
+                inline void NeonStoreFloat4(char *dst, size_t stride, float32x4_t value)
+                {
+                    if (stride == sizeof(float))
+                    {
+                        vst1q_f32(reinterpret_cast<float *>(dst), value);
+                        return;
+                    }
+                    float lanes[4];
+                    vst1q_f32(lanes, value);
+                    for (int k = 0; k < 4; k++)
+                    {
+                        StoreScalar(dst + k * stride, lanes[k]);
+                    }
+                }
+
+                inline float64x2_t NeonLoadDouble2(const char *src, size_t stride)
+                {
+                    if (stride == sizeof(double))
+                    {
+                        return vld1q_f64(reinterpret_cast<const double *>(src));
+                    }
+                    double lanes[2] = {LoadScalar<double>(src), LoadScalar<double>(src + stride)};
+                    return vld1q_f64(lanes);
+                }
+
+                inline void NeonStoreDouble2(char *dst, size_t stride, float64x2_t value)
+                {
+                    if (stride == sizeof(double))
+                    {
+                        vst1q_f64(reinterpret_cast<double *>(dst), value);
+                        return;
+                    }
+                    StoreScalar(dst, vgetq_lane_f64(value, 0));
+                    StoreScalar(dst + stride, vgetq_lane_f64(value, 1));
+                }
+
+                /// Converts four elements per step.
+                template <typename Src, typename Dst>
+                void NeonConvert(const char *src, size_t src_stride,
+                                 char *dst, size_t dst_stride, size_t count)
+                {
+                    if (CopyContiguous<Src, Dst>(src, src_stride, dst, dst_stride, count))
+                    {
+                        return;
+                    }
+                    size_t i = 0;
+                    for (; i + 4 <= count; i += 4, src += 4 * src_stride, dst += 4 * dst_stride)
+                    {
+                        if constexpr (std::is_same<Src, double>::value)
+                        {
+                            float64x2_t lo = NeonLoadDouble2(src, src_stride);
+                            float64x2_t hi = NeonLoadDouble2(src + 2 * src_stride, src_stride);
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                NeonStoreDouble2(dst, dst_stride, lo);
+                                NeonStoreDouble2(dst + 2 * dst_stride, dst_stride, hi);
+                            }
+                            else
+                            {
+                                NeonStoreFloat4(dst, dst_stride,
+                                                vcombine_f32(vcvt_f32_f64(lo), vcvt_f32_f64(hi)));
+                            }
+                        }
+                        else
+                        {
+                            float32x4_t value;
+                            if constexpr (std::is_same<Src, float>::value)
+                            {
+                                value = NeonLoadFloat4(src, src_stride);
+                            }
+                            else
+                            {
+                                std::int32_t lanes[4];
+                                for (int k = 0; k < 4; k++)
+                                {
+                                    lanes[k] = LoadScalar<Src>(src + k * src_stride);
+                                }
+                                int32x4_t ints = vld1q_s32(lanes);
+                                if constexpr (std::is_same<Dst, double>::value)
+                                {
+                                    // 32-bit integers are exact in double but not in
+                                    // float, so widen them directly.
+                                    NeonStoreDouble2(dst, dst_stride,
+                                                     vcvtq_f64_s64(vmovl_s32(vget_low_s32(ints))));
+                                    NeonStoreDouble2(dst + 2 * dst_stride, dst_stride,
+                                                     vcvtq_f64_s64(vmovl_high_s32(ints)));
+                                    continue;
+                                }
+                                value = vcvtq_f32_s32(ints);
+                            }
+                            if constexpr (std::is_same<Dst, double>::value)
+                            {
+                                NeonStoreDouble2(dst, dst_stride, vcvt_f64_f32(vget_low_f32(value)));
+                                NeonStoreDouble2(dst + 2 * dst_stride, dst_stride,
+                                                 vcvt_high_f64_f32(value));
+                            }
+                            else
+                            {
+                                NeonStoreFloat4(dst, dst_stride, value);
+                            }
+                        }
+                    }
+                    ConvertTail<Src, Dst>(src, src_stride, dst, dst_stride, count - i);
+                }
+
+                /// Packed BGR word to an Eigen::Vector3d in [0, 1].
+                void NeonDecodeColor(const char *src, size_t src_stride,
+                                     char *dst, size_t dst_stride, size_t count)
+                {
+                    const float64x2_t scale = vdupq_n_f64(255.0);
+                    for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                    {
+                        const auto *bgra = reinterpret_cast<const std::uint8_t *>(src);
+                        std::uint64_t lanes[2] = {bgra[2], bgra[1]};
+                        float64x2_t rg = vdivq_f64(vcvtq_f64_u64(vld1q_u64(lanes)), scale);
+                        vst1q_f64(reinterpret_cast<double *>(dst), rg);
+                        StoreScalar(dst + 2 * sizeof(double), (double)bgra[0] / 255.0);
+                    }
+                }
+
+                /// Eigen::Vector3d color to a packed BGR word.
+                void NeonEncodeColor(const char *src, size_t src_stride,
+                                     char *dst, size_t dst_stride, size_t count)
+                {
+                    const float64x2_t zero = vdupq_n_f64(0.0);
+                    const float64x2_t one = vdupq_n_f64(1.0);
+                    const float64x2_t scale = vdupq_n_f64(255.0);
+                    for (size_t i = 0; i < count; i++, src += src_stride, dst += dst_stride)
+                    {
+                        // maxnm() returns the number for NaN, which maps NaN to 0
+                        // like the scalar clamp does; vrnda rounds half away from
+                        // zero like std::round.
+                        float64x2_t rg = vld1q_f64(reinterpret_cast<const double *>(src));
+                        float64x2_t b = vdupq_n_f64(LoadScalar<double>(src + 2 * sizeof(double)));
+                        rg = vminq_f64(vmaxnmq_f64(rg, zero), one);
+                        b = vminq_f64(vmaxnmq_f64(b, zero), one);
+                        uint64x2_t rg8 = vcvtq_u64_f64(vrndaq_f64(vmulq_f64(rg, scale)));
+                        uint64x2_t b8 = vcvtq_u64_f64(vrndaq_f64(vmulq_f64(b, scale)));
+                        std::uint32_t word = (std::uint32_t)vgetq_lane_u64(b8, 0) |
+                                             ((std::uint32_t)vgetq_lane_u64(rg8, 1) << 8) |
+                                             ((std::uint32_t)vgetq_lane_u64(rg8, 0) << 16);
+                        StoreScalar(dst, word);
+                    }
+                }
+#endif // PCDIO_SIMD_NEON
+
+                template <typename Src, typename Dst>
+                PCDColumnConverter SelectKernel(SimdLevel level)
+                {
+#if defined(PCDIO_SIMD_X86)
+                    if (level == SIMD_AVX2)
+                    {
+                        return Avx2Convert<Src, Dst>;
+                    }
+                    if (level == SIMD_SSE41)
+                    {
+                        return Sse41Convert<Src, Dst>;
+                    }
+#elif defined(PCDIO_SIMD_NEON)
+                    if (level == SIMD_NEON)
+                    {
+                        return NeonConvert<Src, Dst>;
+                    }
+#endif
+                    return NULL;
+                }
+
+                /// Kernel reading a field of \p type and \p size into \p Dst, NULL
+                /// where the scalar converter stays (U4, whose values do not fit
+                /// the signed lanes, and unknown types).
+                template <typename Dst>
+                PCDColumnConverter SelectDecodeKernel(const char type, const int size,
+                                                      SimdLevel level)
+                {
+                    if (type == 'I')
+                    {
+                        switch (size)
+                        {
+                        case 1:
+                            return SelectKernel<std::int8_t, Dst>(level);
+                        case 2:
+                            return SelectKernel<std::int16_t, Dst>(level);
+                        case 4:
+                            return SelectKernel<std::int32_t, Dst>(level);
+                        }
+                    }
+                    else if (type == 'U')
+                    {
+                        switch (size)
+                        {
+                        case 1:
+                            return SelectKernel<std::uint8_t, Dst>(level);
+                        case 2:
+                            return SelectKernel<std::uint16_t, Dst>(level);
+                        }
+                    }
+                    else if (type == 'F')
+                    {
+                        switch (size)
+                        {
+                        case 4:
+                            return SelectKernel<float, Dst>(level);
+                        case 8:
+                            return SelectKernel<double, Dst>(level);
+                        }
+                    }
+                    return NULL;
+                }
+
+                /// Kernel writing \p Src into a floating point field, NULL for
+                /// integer fields.
+                template <typename Src>
+                PCDColumnConverter SelectEncodeKernel(const char type, const int size,
+                                                      SimdLevel level)
+                {
+                    if (type == 'F' && size == 4)
+                    {
+                        return SelectKernel<Src, float>(level);
+                    }
+                    if (type == 'F' && size == 8)
+                    {
+                        return SelectKernel<Src, double>(level);
+                    }
+                    return NULL;
+                }
+
+                SimdLevel DetectSimdLevel()
+                {
+                    SimdLevel level = SIMD_NONE;
+#if defined(PCDIO_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+                    __builtin_cpu_init();
+                    if (__builtin_cpu_supports("avx2"))
+                    {
+                        level = SIMD_AVX2;
+                    }
+                    else if (__builtin_cpu_supports("sse4.1"))
+                    {
+                        level = SIMD_SSE41;
+                    }
+#elif defined(PCDIO_SIMD_X86)
+                    int info[4];
+                    __cpuid(info, 1);
+                    bool sse41 = (info[2] & (1 << 19)) != 0;
+                    // AVX state must also be enabled by the OS.
+                    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                               (_xgetbv(0) & 6) == 6;
+                    __cpuidex(info, 7, 0);
+                    bool avx2 = avx && (info[1] & (1 << 5)) != 0;
+                    level = avx2 ? SIMD_AVX2 : (sse41 ? SIMD_SSE41 : SIMD_NONE);
+#elif defined(PCDIO_SIMD_NEON)
+                    level = SIMD_NEON;
+#endif
+                    const char *request = getenv("PCDIO_SIMD");
+                    if (request == NULL)
+                    {
+                        return level;
+                    }
+                    const SimdLevel levels[] = {SIMD_NONE, SIMD_SSE41, SIMD_AVX2, SIMD_NEON};
+                    for (SimdLevel requested : levels)
+                    {
+                        if (strcmp(request, SimdLevelName(requested)) != 0)
+                        {
+                            continue;
+                        }
+                        // AVX2 CPUs also run the SSE4.1 kernels, nothing else can be
+                        // raised or swapped.
+                        if (requested == SIMD_NONE || requested == level ||
+                            (requested == SIMD_SSE41 && level == SIMD_AVX2))
+                        {
+                            return requested;
+                        }
+                        utility::LogWarning("[GetSimdLevel] PCDIO_SIMD=%s is not supported, using %s.\n",
+                                            request, SimdLevelName(level));
+                        return level;
+                    }
+                    utility::LogWarning("[GetSimdLevel] Unknown PCDIO_SIMD value %s, using %s.\n",
+                                        request, SimdLevelName(level));
+                    return level;
+                }
+            } // unnamed namespace
+
+            SimdLevel GetSimdLevel()
+            {
+                static const SimdLevel level = DetectSimdLevel();
+                return level;
+            }
+
+            const char *SimdLevelName(SimdLevel level)
+            {
+                switch (level)
+                {
+                case SIMD_SSE41:
+                    return "sse4.1";
+                case SIMD_AVX2:
+                    return "avx2";
+                case SIMD_NEON:
+                    return "neon";
+                case SIMD_NONE:
+                default:
+                    return "none";
+                }
+            }
+
+            void SelectSimdConverters(const char type, const int size,
+                                      PCDFieldCodec &codec)
+            {
+                SimdLevel level = GetSimdLevel();
+                if (level == SIMD_NONE)
+                {
+                    return;
+                }
+                if (codec.slot == PCD_SLOT_RGB)
+                {
+#if defined(PCDIO_SIMD_X86)
+                    if (size == 4)
+                    {
+                        codec.decode[PCD_SLOT_COLOR3D] = Sse41DecodeColor;
+                        codec.encode[PCD_SLOT_COLOR3D] = Sse41EncodeColor;
+                    }
+#elif defined(PCDIO_SIMD_NEON)
+                    if (size == 4)
+                    {
+                        codec.decode[PCD_SLOT_COLOR3D] = NeonDecodeColor;
+                        codec.encode[PCD_SLOT_COLOR3D] = NeonEncodeColor;
+                    }
+#endif
+                    return;
+                }
+                PCDColumnConverter kernel;
+                if ((kernel = SelectDecodeKernel<float>(type, size, level)) != NULL)
+                {
+                    codec.decode[PCD_SLOT_FLOAT32] = kernel;
+                }
+                if ((kernel = SelectDecodeKernel<double>(type, size, level)) != NULL)
+                {
+                    codec.decode[PCD_SLOT_FLOAT64] = kernel;
+                }
+                if ((kernel = SelectEncodeKernel<float>(type, size, level)) != NULL)
+                {
+                    codec.encode[PCD_SLOT_FLOAT32] = kernel;
+                }
+                if ((kernel = SelectEncodeKernel<double>(type, size, level)) != NULL)
+                {
+                    codec.encode[PCD_SLOT_FLOAT64] = kernel;
+                }
+            }
+        } // namespace internal
+    } // namespace io
+} // namespace pcd
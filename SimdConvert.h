@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include "PCDFormat.h"
+
+namespace pcd
+{
+    namespace io
+    {
+        namespace internal
+        {
+            /// Instruction set used by the vectorised column converters.
+            enum SimdLevel
+            {
+                SIMD_NONE = 0,
+                SIMD_SSE41,
+                SIMD_AVX2,
+                SIMD_NEON
+            };
+
+            /// \brief Returns the best instruction set supported by the running CPU.
+            ///
+            /// Detection runs once. The PCDIO_SIMD environment variable ("none",
+            /// "sse4.1", "avx2" or "neon") lowers the level, e.g. to compare
+            /// kernels. Values the CPU does not support, such as "avx2" on an
+            /// SSE4.1 CPU or "neon" on x86, keep the detected level with a
+            /// warning. Building with PCDIO_NO_SIMD defined always yields SIMD_NONE.
+            SimdLevel GetSimdLevel();
+
+            /// Name of \p level for logs and benchmarks.
+            const char *SimdLevelName(SimdLevel level);
+
+            /// \brief Replaces the converters of \p codec that have a vectorised
+            /// counterpart for the current SimdLevel.
+            ///
+            /// The vectorised converters produce bit-identical results to the
+            /// scalar ones and accept any strides; contiguous columns, such as
+            /// binary_compressed stripes and SoA clouds, take the fastest path.
+            /// Packed BGR rgb columns read into or written from Eigen::Vector3d
+            /// use SSE4.1 kernels on x86, at the AVX2 level too, and NEON kernels
+            /// on aarch64.
+            void SelectSimdConverters(const char type, const int size,
+                                      PCDFieldCodec &codec);
+        } // namespace internal
+    } // namespace io
+} // namespace pcd
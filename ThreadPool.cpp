@@ -0,0 +1,124 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace pcd
+{
+    namespace utility
+    {
+        namespace
+        {
+            // Set while the current thread runs a loop body.
+            thread_local bool tls_in_parallel_loop = false;
+        } // unnamed namespace
+
+        ThreadPool::ThreadPool(size_t num_threads)
+        {
+            if (num_threads == 0)
+            {
+                num_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            for (size_t i = 1; i < num_threads; i++)
+            {
+                workers_.emplace_back([this]()
+                                      { WorkerLoop(); });
+            }
+        }
+
+        ThreadPool::~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto &worker : workers_)
+            {
+                worker.join();
+            }
+        }
+
+        ThreadPool &ThreadPool::Global()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        void ThreadPool::RunIndices(const std::function<void(size_t)> &body,
+                                    size_t count)
+        {
+            bool nested = tls_in_parallel_loop;
+            tls_in_parallel_loop = true;
+            for (size_t i = next_.fetch_add(1); i < count; i = next_.fetch_add(1))
+            {
+                body(i);
+            }
+            tls_in_parallel_loop = nested;
+        }
+
+        void ThreadPool::ParallelFor(size_t count,
+                                     const std::function<void(size_t)> &body,
+                                     size_t max_threads)
+        {
+            size_t helpers = std::min(workers_.size(), count > 0 ? count - 1 : 0);
+            if (max_threads > 0)
+            {
+                helpers = std::min(helpers, max_threads - 1);
+            }
+            if (helpers == 0 || tls_in_parallel_loop)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    body(i);
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                body_ = &body;
+                count_ = count;
+                next_ = 0;
+                helpers_wanted_ = helpers;
+            }
+            wake_.notify_all();
+            RunIndices(body, count);
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Workers that have not joined yet would find no work left.
+            helpers_wanted_ = 0;
+            done_.wait(lock, [this]()
+                       { return running_ == 0; });
+            body_ = nullptr;
+        }
+
+        void ThreadPool::WorkerLoop()
+        {
+            while (true)
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this]()
+                           { return stop_ || helpers_wanted_ > 0; });
+                if (stop_)
+                {
+                    return;
+                }
+                helpers_wanted_--;
+                running_++;
+                const std::function<void(size_t)> &body = *body_;
+                size_t count = count_;
+                lock.unlock();
+                RunIndices(body, count);
+                lock.lock();
+                if (--running_ == 0)
+                {
+                    done_.notify_all();
+                }
+            }
+        }
+    } // namespace utility
+} // namespace pcd
@@ -0,0 +1,75 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Geometry.h"
+
+namespace pcd
+{
+    namespace utility
+    {
+        /// \class ThreadPool
+        ///
+        /// \brief Fixed set of worker threads running data-parallel loops.
+        ///
+        /// The calling thread always takes part in the loop, so a pool created
+        /// with N threads keeps N - 1 workers. Loops issued from inside a loop
+        /// body run serially on the calling thread.
+        class PCDIO_EXPORTS ThreadPool
+        {
+        public:
+            /// \param num_threads Number of threads including the caller, 0 uses
+            /// one per hardware thread.
+            explicit ThreadPool(size_t num_threads = 0);
+            ~ThreadPool();
+            ThreadPool(const ThreadPool &) = delete;
+            ThreadPool &operator=(const ThreadPool &) = delete;
+
+        public:
+            /// Number of threads a loop can run on, including the caller.
+            size_t NumThreads() const { return workers_.size() + 1; }
+
+            /// \brief Calls \p body for every index in [0, \p count) and returns
+            /// once all calls have finished.
+            ///
+            /// \param max_threads Upper bound on the threads used, 0 for no bound.
+            void ParallelFor(size_t count,
+                             const std::function<void(size_t)> &body,
+                             size_t max_threads = 0);
+
+            /// Process-wide pool sized to the hardware.
+            static ThreadPool &Global();
+
+        private:
+            void WorkerLoop();
+            void RunIndices(const std::function<void(size_t)> &body, size_t count);
+
+        private:
+            std::vector<std::thread> workers_;
+            /// Serializes loops issued by different threads.
+            std::mutex submit_mutex_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::condition_variable done_;
+            const std::function<void(size_t)> *body_ = nullptr;
+            size_t count_ = 0;
+            std::atomic<size_t> next_{0};
+            /// Workers still allowed to join the current loop.
+            size_t helpers_wanted_ = 0;
+            /// Workers currently running the current loop.
+            size_t running_ = 0;
+            bool stop_ = false;
+        };
+    } // namespace utility
+} // namespace pcd
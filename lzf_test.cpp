@@ -0,0 +1,367 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+// Checks lzfDecompress against the byte-wise reference decoder it replaced,
+// and the block index path of binary_compressed data against both.
+//
+//   lzf_test [--cases N]
+// ----------------------------------------------------------------------------
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BlockCodec.h"
+#include "LZF.h"
+#include "Logging.h"
+#include "PCDFormat.h"
+
+namespace
+{
+    using namespace pcd;
+
+    /// The original lzf_decompress, copying one byte at a time.
+    unsigned int ReferenceDecompress(const void *const in_data, unsigned int in_len,
+                                     void *out_data, unsigned int out_len)
+    {
+        auto const *ip = static_cast<const unsigned char *>(in_data);
+        auto *op = static_cast<unsigned char *>(out_data);
+        unsigned char const *const in_end = ip + in_len;
+        unsigned char *const out_end = op + out_len;
+
+        do
+        {
+            unsigned int ctrl = *ip++;
+
+            if (ctrl < (1 << 5))
+            {
+                ctrl++;
+                if (op + ctrl > out_end)
+                {
+                    errno = E2BIG;
+                    return 0;
+                }
+                if (ip + ctrl > in_end)
+                {
+                    errno = EINVAL;
+                    return 0;
+                }
+                for (unsigned ctrl_c = ctrl; ctrl_c; --ctrl_c)
+                    *op++ = *ip++;
+            }
+            else
+            {
+                unsigned int len = ctrl >> 5;
+                // offsets are kept as integers, the pointer may not exist
+                size_t back = (size_t)((ctrl & 0x1f) << 8) + 1;
+
+                if (ip >= in_end)
+                {
+                    errno = EINVAL;
+                    return 0;
+                }
+                if (len == 7)
+                {
+                    len += *ip++;
+                    if (ip >= in_end)
+                    {
+                        errno = EINVAL;
+                        return 0;
+                    }
+                }
+                back += *ip++;
+
+                if (op + len + 2 > out_end)
+                {
+                    errno = E2BIG;
+                    return 0;
+                }
+                if (back > (size_t)(op - static_cast<unsigned char *>(out_data)))
+                {
+                    errno = EINVAL;
+                    return 0;
+                }
+                unsigned char *ref = op - back;
+                for (unsigned len_c = len + 2; len_c; --len_c)
+                    *op++ = *ref++;
+            }
+        } while (ip < in_end);
+
+        return (unsigned int)(op - static_cast<unsigned char *>(out_data));
+    }
+
+    int failures = 0;
+
+    void Fail(const std::string &name, const char *what)
+    {
+        fprintf(stderr, "[lzf_test] %s: %s\n", name.c_str(), what);
+        failures++;
+    }
+
+    /// Sample data of \p size bytes: random, runs with short periods, slowly
+    /// varying floats, or a mix of the three.
+    std::vector<char> MakeData(std::mt19937 &rng, size_t size, int kind)
+    {
+        std::vector<char> data(size);
+        std::uniform_int_distribution<int> byte(0, 255);
+        switch (kind)
+        {
+        case 0:
+            for (auto &c : data)
+            {
+                c = (char)byte(rng);
+            }
+            break;
+        case 1:
+        {
+            size_t period = 1 + rng() % 24;
+            for (size_t i = 0; i < size; i++)
+            {
+                data[i] = (char)(i % period == 0 ? byte(rng) % 4 : data[i - i % period]);
+            }
+            break;
+        }
+        case 2:
+        {
+            float value = (float)(rng() % 1000);
+            for (size_t i = 0; i + 4 <= size; i += 4)
+            {
+                value += (float)(rng() % 3) * 0.125f;
+                memcpy(&data[i], &value, 4);
+            }
+            break;
+        }
+        default:
+            for (size_t i = 0; i < size; i++)
+            {
+                bool literal = (i / 64) % 3 == 0;
+                data[i] = literal ? (char)byte(rng) : (char)(i / 7);
+            }
+            break;
+        }
+        return data;
+    }
+
+    /// Decodes \p stream with both decoders into buffers of \p out_len bytes
+    /// followed by a guard, and compares result, errno and every byte.
+    void CompareDecoders(const std::string &name, const std::vector<char> &stream,
+                         unsigned int out_len)
+    {
+        const size_t guard = 64;
+        std::vector<char> expected(out_len + guard, (char)0x5a);
+        std::vector<char> actual(out_len + guard, (char)0x5a);
+        errno = 0;
+        unsigned int expected_size = ReferenceDecompress(stream.data(), (unsigned int)stream.size(),
+                                                         expected.data(), out_len);
+        int expected_errno = expected_size == 0 ? errno : 0;
+        errno = 0;
+        unsigned int actual_size = lzfDecompress(stream.data(), (unsigned int)stream.size(),
+                                                 actual.data(), out_len);
+        int actual_errno = actual_size == 0 ? errno : 0;
+        if (actual_size != expected_size || actual_errno != expected_errno)
+        {
+            Fail(name, "result differs from the reference decoder");
+            return;
+        }
+        // Failed decodes may leave partial output, which only has to stay in
+        // bounds.
+        if (memcmp(actual.data(), expected.data(), expected_size) != 0)
+        {
+            Fail(name, "output differs from the reference decoder");
+        }
+        for (size_t i = out_len; i < out_len + guard; i++)
+        {
+            if (actual[i] != (char)0x5a)
+            {
+                Fail(name, "wrote past the output buffer");
+                break;
+            }
+        }
+    }
+
+    void TestDecoder(std::mt19937 &rng, int cases)
+    {
+        const int levels[] = {io::CODEC_LEVEL_FAST, io::CODEC_LEVEL_DEFAULT, io::CODEC_LEVEL_BEST};
+        for (int i = 0; i < cases; i++)
+        {
+            size_t size = 1 + rng() % (i % 5 == 0 ? 70000 : 600);
+            int kind = i % 4;
+            int level = levels[i % 3];
+            std::string name = "case " + std::to_string(i) + " (kind " +
+                               std::to_string(kind) + ", level " + std::to_string(level) +
+                               ", " + std::to_string(size) + " bytes)";
+            auto data = MakeData(rng, size, kind);
+            std::vector<char> stream(size + size / 16 + 64);
+            unsigned int compressed = lzfCompress(data.data(), (unsigned int)size, stream.data(),
+                                                  (unsigned int)stream.size(), level);
+            if (compressed == 0)
+            {
+                Fail(name, "compression failed");
+                continue;
+            }
+            stream.resize(compressed);
+
+            std::vector<char> output(size);
+            if (lzfDecompress(stream.data(), compressed, output.data(), (unsigned int)size) !=
+                    size ||
+                output != data)
+            {
+                Fail(name, "round trip failed");
+            }
+            CompareDecoders(name, stream, (unsigned int)size);
+            // Too short buffers are rejected identically.
+            CompareDecoders(name + " short", stream, (unsigned int)(rng() % size));
+            // So are truncated and corrupted streams.
+            auto truncated = stream;
+            truncated.resize(1 + rng() % compressed);
+            CompareDecoders(name + " truncated", truncated, (unsigned int)size);
+            auto mutated = stream;
+            for (int flips = 0; flips < 4; flips++)
+            {
+                mutated[rng() % compressed] ^= (char)(1 + rng() % 255);
+            }
+            CompareDecoders(name + " mutated", mutated, (unsigned int)size);
+        }
+    }
+
+    /// Compresses \p points xyz points the way CompressPCDData does, then reads
+    /// them back through the block index and as one plain LZF stream.
+    void TestBlocks(std::mt19937 &rng, int points, size_t block_size, size_t expected_blocks)
+    {
+        using namespace io::internal;
+        std::string name = "blocks of " + std::to_string(points) + " points";
+        PCDHeader header;
+        if (!GenerateHeader((size_t)points, false, false, false, false, true, header) ||
+            !CheckHeader(header))
+        {
+            Fail(name, "bad header");
+            return;
+        }
+        size_t size = (size_t)header.pointsize * points;
+        auto data = MakeData(rng, size, 2);
+
+        std::vector<LZFBlock> blocks;
+        PCDScratchBuffer output;
+        std::uint32_t compressed_size = CompressBlocks(
+            data.data(), size, block_size, 0, io::LZFBlockCodec(), io::CODEC_LEVEL_DEFAULT, blocks,
+            output);
+        if (compressed_size == 0)
+        {
+            Fail(name, "compression failed");
+            return;
+        }
+        if (blocks.size() != expected_blocks)
+        {
+            Fail(name, "unexpected number of blocks");
+            return;
+        }
+        std::vector<char> stream;
+        header.lzf_block_size = block_size;
+        header.lzf_blocks.clear();
+        for (const auto &block : blocks)
+        {
+            stream.insert(stream.end(), output.Data() + block.output_offset,
+                          output.Data() + block.output_offset + block.compressed_size);
+            header.lzf_blocks.push_back(block.compressed_size);
+        }
+
+        std::vector<char> decoded(size);
+        if (!DecompressBlocks(header, stream.data(), compressed_size, decoded.data(),
+                              (std::uint32_t)size) ||
+            decoded != data)
+        {
+            Fail(name, "block index decode failed");
+        }
+        // A block size whose product with the block count wraps around must
+        // not pass as an index, the stream is then decoded serially.
+        if (blocks.size() > 1)
+        {
+            header.lzf_block_size = SIZE_MAX / (blocks.size() - 1) + 1;
+            std::fill(decoded.begin(), decoded.end(), 0);
+            if (!DecompressBlocks(header, stream.data(), compressed_size, decoded.data(),
+                                  (std::uint32_t)size) ||
+                decoded != data)
+            {
+                Fail(name, "wrapping block size was not rejected");
+            }
+        }
+        // Readers without the index see one LZF stream.
+        header.lzf_blocks.clear();
+        std::fill(decoded.begin(), decoded.end(), 0);
+        if (!DecompressBlocks(header, stream.data(), compressed_size, decoded.data(),
+                              (std::uint32_t)size) ||
+            decoded != data)
+        {
+            Fail(name, "serial decode failed");
+        }
+        CompareDecoders(name, stream, (unsigned int)size);
+    }
+
+    /// Parses a header carrying the block index line \p index and checks
+    /// whether the index was kept.
+    void TestIndexLine(const std::string &index, bool expected)
+    {
+        using namespace io::internal;
+        std::string text = "VERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\nTYPE F F F\n"
+                           "COUNT 1 1 1\nWIDTH 2731\nHEIGHT 1\n"
+                           "VIEWPOINT 0 0 0 1 0 0 0\nPOINTS 2731\n"
+                           "# PCDIO_LZF_BLOCKS " +
+                           index + "\nDATA binary_compressed\n";
+        const char *data = text.data();
+        PCDHeader header;
+        if (!ReadPCDHeader(data, text.data() + text.size(), header))
+        {
+            Fail("index " + index, "header rejected");
+            return;
+        }
+        if (header.lzf_blocks.empty() == expected)
+        {
+            Fail("index " + index, expected ? "index dropped" : "malformed index kept");
+        }
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int cases = 2000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cases") == 0 && i + 1 < argc)
+        {
+            cases = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "[lzf_test] Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    pcd::utility::SetVerbosityLevel(pcd::utility::VerbosityLevel::Error);
+    std::mt19937 rng(20181);
+    TestDecoder(rng, cases);
+    // 32772 bytes in blocks of 1024: the 4 byte tail is merged into block 32.
+    TestBlocks(rng, 2731, 1024, 32);
+    // 36000 bytes: a regular 160 byte tail block.
+    TestBlocks(rng, 3000, 1024, 36);
+    // 12 bytes: a single block, so no usable index.
+    TestBlocks(rng, 1, 1024, 1);
+    TestIndexLine("1024 2 10 20", true);
+    TestIndexLine("4294967296 2 10 20", false);
+    TestIndexLine("1024 3 10 20", false);
+    TestIndexLine("1024 2 10 4294967296", false);
+    TestIndexLine("1024 2 10 x", false);
+    TestIndexLine("1024x 2 10 20", false);
+    if (failures != 0)
+    {
+        fprintf(stderr, "[lzf_test] %d failures\n", failures);
+        return 1;
+    }
+    printf("[lzf_test] OK\n");
+    return 0;
+}
@@ -0,0 +1,485 @@
+// ----------------------------------------------------------------------------
+// -                        PCD RW                            -
+// ----------------------------------------------------------------------------
+// Copyright (c) 2018-2023 JD
+// ----------------------------------------------------------------------------
+// Read/write throughput benchmark on synthetic clouds, reported as JSON.
+//
+//   pcd_bench [--points N] [--repeat R] [--threads T] [--dir DIR]
+//             [--fields xyz,xyzi,xyznc] [--formats ascii,binary,binary_compressed]
+//             [--levels fast,default,best] [--filters none,shuffle,delta,xor]
+//             [--codecs lzf,lz4,store] [--quantize STEP] [--cloud aos|soa]
+//   pcd_bench --help
+// ----------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BlockCodec.h"
+#include "PointCloudIO.h"
+#include "PointCloudSoA.h"
+#include "SimdConvert.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    using namespace pcd;
+
+    struct BenchOptions
+    {
+        size_t points = 1000000;
+        int repeat = 3;
+        int threads = 0;
+        std::string dir;
+        std::vector<std::string> fields = {"xyz", "xyzi", "xyznc"};
+        std::vector<std::string> formats = {"ascii", "binary", "binary_compressed"};
+        // compression levels measured for binary_compressed
+        std::vector<std::string> levels = {"fast", "default", "best"};
+        // stripe filters measured for binary_compressed
+        std::vector<std::string> filters = {"none"};
+        // block codecs measured for binary_compressed
+        std::vector<std::string> codecs = {"lzf"};
+        // quantization step of binary coordinates, 0 for floats
+        double quantize = 0;
+        bool soa = false;
+    };
+
+    struct BenchResult
+    {
+        std::string fields;
+        std::string format;
+        // compression level, empty for uncompressed formats and store
+        std::string level;
+        // stripe filter, empty for uncompressed formats
+        std::string filter;
+        // block codec, empty for uncompressed formats
+        std::string codec;
+        size_t data_bytes = 0;
+        size_t file_bytes = 0;
+        double write_seconds = 0;
+        double read_seconds = 0;
+        // stage timings of the fastest runs
+        io::IOStats write_stats;
+        io::IOStats read_stats;
+        bool ok = true;
+    };
+
+    std::vector<std::string> SplitList(const char *list)
+    {
+        std::vector<std::string> items;
+        std::string item;
+        for (const char *c = list;; c++)
+        {
+            if (*c == ',' || *c == '\0')
+            {
+                if (!item.empty())
+                {
+                    items.push_back(item);
+                }
+                item.clear();
+                if (*c == '\0')
+                {
+                    break;
+                }
+            }
+            else
+            {
+                item += *c;
+            }
+        }
+        return items;
+    }
+
+    /// Builds a cloud shaped like a 64-ring spinning lidar sweep, so that
+    /// compression ratios resemble real captures rather than random noise.
+    geometry::PointCloud GenerateCloud(size_t points, const std::string &fields)
+    {
+        geometry::PointCloud cloud;
+        bool has_intensitys = fields == "xyzi";
+        bool has_normals_colors = fields == "xyznc";
+        std::mt19937 rng(42);
+        std::normal_distribution<double> noise(0.0, 0.02);
+        const size_t rings = 64;
+        cloud.points_.resize(points);
+        if (has_intensitys)
+        {
+            cloud.intensitys_.resize(points);
+        }
+        if (has_normals_colors)
+        {
+            cloud.normals_.resize(points);
+            cloud.colors_.resize(points);
+        }
+        for (size_t i = 0; i < points; i++)
+        {
+            double elevation = -0.4 + 0.5 * (double)(i % rings) / rings;
+            double azimuth = 2.0 * M_PI * (double)(i / rings) * rings / std::max<size_t>(points, 1);
+            double range = 15.0 + 5.0 * std::sin(azimuth * 7.0) + noise(rng);
+            Eigen::Vector3d dir(std::cos(elevation) * std::cos(azimuth),
+                                std::cos(elevation) * std::sin(azimuth),
+                                std::sin(elevation));
+            cloud.points_[i] = dir * range;
+            if (has_intensitys)
+            {
+                cloud.intensitys_[i] = (float)((int)(range * 8.0) % 256);
+            }
+            if (has_normals_colors)
+            {
+                cloud.normals_[i] = -dir;
+                double shade = 0.5 + 0.5 * std::sin(cloud.points_[i](2));
+                cloud.colors_[i] = Eigen::Vector3d(shade, 1.0 - shade, 0.5);
+            }
+        }
+        return cloud;
+    }
+
+    double Seconds(std::chrono::steady_clock::time_point begin)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    template <typename PointCloudT>
+    size_t CountPoints(const PointCloudT &cloud)
+    {
+        return cloud.Size();
+    }
+
+    template <>
+    size_t CountPoints<geometry::PointCloud>(const geometry::PointCloud &cloud)
+    {
+        return cloud.points_.size();
+    }
+
+    /// Writes and reads \p cloud \p repeat times and keeps the best timings.
+    template <typename PointCloudT>
+    void RunCase(const PointCloudT &cloud, const std::string &filename,
+                 const BenchOptions &options, BenchResult &result)
+    {
+        io::WritePointCloudOption params(result.format == "ascii",
+                                         result.format == "binary_compressed");
+        params.num_threads = options.threads;
+        params.quantization_step = options.quantize;
+        if (result.level == "fast")
+        {
+            params.compression_level = io::WritePointCloudOption::CompressionLevel::Fast;
+        }
+        else if (result.level == "best")
+        {
+            params.compression_level = io::WritePointCloudOption::CompressionLevel::Best;
+        }
+        if (!result.codec.empty())
+        {
+            params.compression_codec = result.codec;
+        }
+        if (result.filter == "shuffle")
+        {
+            params.compression_filter = io::WritePointCloudOption::CompressionFilter::Shuffle;
+        }
+        else if (result.filter == "delta")
+        {
+            params.compression_filter = io::WritePointCloudOption::CompressionFilter::DeltaShuffle;
+        }
+        else if (result.filter == "xor")
+        {
+            params.compression_filter = io::WritePointCloudOption::CompressionFilter::XorShuffle;
+        }
+        io::IOStats write_stats, read_stats;
+        params.stats = &write_stats;
+        io::ReadPointCloudOption read_params;
+        read_params.stats = &read_stats;
+        result.write_seconds = result.read_seconds = INFINITY;
+        for (int r = 0; r < options.repeat && result.ok; r++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            result.ok = io::WritePointCloudToPCD(filename, cloud, params);
+            double seconds = Seconds(begin);
+            if (seconds < result.write_seconds)
+            {
+                result.write_seconds = seconds;
+                result.write_stats = write_stats;
+            }
+
+            PointCloudT loaded;
+            begin = std::chrono::steady_clock::now();
+            result.ok = result.ok && io::ReadPointCloudFromPCD(filename, loaded, read_params);
+            seconds = Seconds(begin);
+            if (seconds < result.read_seconds)
+            {
+                result.read_seconds = seconds;
+                result.read_stats = read_stats;
+            }
+            result.ok = result.ok && CountPoints(loaded) == CountPoints(cloud);
+        }
+        std::error_code error;
+        auto file_bytes = std::filesystem::file_size(filename, error);
+        result.file_bytes = error ? 0 : (size_t)file_bytes;
+        std::filesystem::remove(filename, error);
+    }
+
+    void PrintStages(const char *name, const io::IOStats &stats)
+    {
+        printf("\"%s\": {\"header\": %.6f, \"io\": %.6f, \"compression\": %.6f, "
+               "\"conversion\": %.6f}",
+               name, stats.header_seconds, stats.io_seconds, stats.compression_seconds,
+               stats.conversion_seconds);
+    }
+
+    void PrintResult(BenchResult result, size_t points, bool last)
+    {
+        // JSON has no infinity, failed cases report zero rates instead.
+        if (!result.ok)
+        {
+            result.write_seconds = result.read_seconds = INFINITY;
+        }
+        double file_mb = result.file_bytes / 1e6;
+        std::string level = result.level.empty() ? "null" : "\"" + result.level + "\"";
+        std::string filter = result.filter.empty() ? "null" : "\"" + result.filter + "\"";
+        std::string codec = result.codec.empty() ? "null" : "\"" + result.codec + "\"";
+        printf("    {\"fields\": \"%s\", \"format\": \"%s\", \"codec\": %s, \"level\": %s, "
+               "\"filter\": %s, \"ok\": %s, "
+               "\"data_bytes\": %zu, \"file_bytes\": %zu, \"compression_ratio\": %.4f, "
+               "\"write_seconds\": %.6f, \"read_seconds\": %.6f, "
+               "\"write_mb_per_s\": %.2f, \"read_mb_per_s\": %.2f, "
+               "\"write_points_per_s\": %.0f, \"read_points_per_s\": %.0f, ",
+               result.fields.c_str(), result.format.c_str(), codec.c_str(), level.c_str(),
+               filter.c_str(),
+               result.ok ? "true" : "false",
+               result.data_bytes, result.file_bytes,
+               result.file_bytes > 0 ? (double)result.data_bytes / result.file_bytes : 0.0,
+               std::isinf(result.write_seconds) ? 0.0 : result.write_seconds,
+               std::isinf(result.read_seconds) ? 0.0 : result.read_seconds,
+               file_mb / result.write_seconds, file_mb / result.read_seconds,
+               points / result.write_seconds, points / result.read_seconds);
+        PrintStages("write_stages", result.write_stats);
+        printf(", ");
+        PrintStages("read_stages", result.read_stats);
+        printf("}%s\n", last ? "" : ",");
+    }
+
+    void PrintUsage(FILE *file)
+    {
+        fprintf(file,
+                "Usage: pcd_bench [options]\n"
+                "Writes and reads synthetic clouds, prints the throughput as JSON.\n"
+                "\n"
+                "  --points N         points per cloud (1000000)\n"
+                "  --repeat R         runs per case, the fastest is kept (3)\n"
+                "  --threads T        worker threads, 0 for one per core (0)\n"
+                "  --dir DIR          directory of the temporary files (system temp)\n"
+                "  --fields LIST      xyz,xyzi,xyznc (all)\n"
+                "  --formats LIST     ascii,binary,binary_compressed (all)\n"
+                "  --levels LIST      fast,default,best, binary_compressed only (all)\n"
+                "  --filters LIST     none,shuffle,delta,xor, binary_compressed only (none)\n"
+                "  --codecs LIST      lzf,lz4,store, binary_compressed only (lzf)\n"
+                "  --quantize STEP    store coordinates as integers in steps of STEP (0, off)\n"
+                "  --cloud aos|soa    PointCloud or PointCloudSoA (aos)\n"
+                "  -h, --help         print this help\n");
+    }
+
+    bool ParseOptions(int argc, char **argv, BenchOptions &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h")
+            {
+                PrintUsage(stdout);
+                exit(0);
+            }
+            const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+            if (value == NULL)
+            {
+                fprintf(stderr, "[pcd_bench] Missing value for %s\n", arg.c_str());
+                return false;
+            }
+            if (arg == "--points")
+            {
+                options.points = std::strtoul(value, NULL, 10);
+            }
+            else if (arg == "--repeat")
+            {
+                options.repeat = std::max(1, atoi(value));
+            }
+            else if (arg == "--threads")
+            {
+                options.threads = atoi(value);
+            }
+            else if (arg == "--dir")
+            {
+                options.dir = value;
+            }
+            else if (arg == "--fields")
+            {
+                options.fields = SplitList(value);
+            }
+            else if (arg == "--formats")
+            {
+                options.formats = SplitList(value);
+            }
+            else if (arg == "--levels")
+            {
+                options.levels = SplitList(value);
+            }
+            else if (arg == "--filters")
+            {
+                options.filters = SplitList(value);
+            }
+            else if (arg == "--codecs")
+            {
+                options.codecs = SplitList(value);
+            }
+            else if (arg == "--quantize")
+            {
+                options.quantize = std::strtod(value, NULL);
+            }
+            else if (arg == "--cloud")
+            {
+                options.soa = std::string(value) == "soa";
+            }
+            else
+            {
+                fprintf(stderr, "[pcd_bench] Unknown option %s\n", arg.c_str());
+                PrintUsage(stderr);
+                return false;
+            }
+            i++;
+        }
+        for (const auto &fields : options.fields)
+        {
+            if (fields != "xyz" && fields != "xyzi" && fields != "xyznc")
+            {
+                fprintf(stderr, "[pcd_bench] Unknown field set %s\n", fields.c_str());
+                return false;
+            }
+        }
+        for (const auto &format : options.formats)
+        {
+            if (format != "ascii" && format != "binary" && format != "binary_compressed")
+            {
+                fprintf(stderr, "[pcd_bench] Unknown format %s\n", format.c_str());
+                return false;
+            }
+        }
+        for (const auto &level : options.levels)
+        {
+            if (level != "fast" && level != "default" && level != "best")
+            {
+                fprintf(stderr, "[pcd_bench] Unknown level %s\n", level.c_str());
+                return false;
+            }
+        }
+        for (const auto &filter : options.filters)
+        {
+            if (filter != "none" && filter != "shuffle" && filter != "delta" && filter != "xor")
+            {
+                fprintf(stderr, "[pcd_bench] Unknown filter %s\n", filter.c_str());
+                return false;
+            }
+        }
+        for (const auto &codec : options.codecs)
+        {
+            if (io::FindBlockCodec(codec) == NULL)
+            {
+                fprintf(stderr, "[pcd_bench] Unknown codec %s\n", codec.c_str());
+                return false;
+            }
+        }
+        if (!(options.quantize >= 0))
+        {
+            fprintf(stderr, "[pcd_bench] Bad quantization step %g\n", options.quantize);
+            return false;
+        }
+        if (options.dir.empty())
+        {
+            options.dir = std::filesystem::temp_directory_path().string();
+        }
+        return options.points > 0;
+    }
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    std::vector<BenchResult> results;
+    for (const auto &fields : options.fields)
+    {
+        geometry::PointCloud cloud = GenerateCloud(options.points, fields);
+        geometry::PointCloudSoA soa(cloud);
+        // every field of the generated files is a 4-byte float
+        size_t fields_per_point = fields == "xyzi" ? 4 : (fields == "xyznc" ? 7 : 3);
+        for (const auto &format : options.formats)
+        {
+            std::vector<std::string> levels = {""};
+            std::vector<std::string> filters = {""};
+            std::vector<std::string> codecs = {""};
+            if (format == "binary_compressed")
+            {
+                levels = options.levels;
+                filters = options.filters;
+                codecs = options.codecs;
+            }
+            for (const auto &codec : codecs)
+            {
+                // store has no levels
+                size_t num_levels = codec == "store" ? 1 : levels.size();
+                for (const auto &filter : filters)
+                {
+                    for (size_t l = 0; l < num_levels; l++)
+                    {
+                        BenchResult result;
+                        result.fields = fields;
+                        result.format = format;
+                        result.codec = codec;
+                        result.level = codec == "store" ? "" : levels[l];
+                        result.filter = filter;
+                        result.data_bytes = options.points * fields_per_point * 4;
+                        std::string filename =
+                            options.dir + "/pcd_bench_" + fields + "_" + format + ".pcd";
+                        if (options.soa)
+                        {
+                            RunCase(soa, filename, options, result);
+                        }
+                        else
+                        {
+                            RunCase(cloud, filename, options, result);
+                        }
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("{\n");
+    printf("  \"benchmark\": \"pcd_io\",\n");
+    printf("  \"points\": %zu,\n", options.points);
+    printf("  \"repeat\": %d,\n", options.repeat);
+    printf("  \"cloud\": \"%s\",\n", options.soa ? "soa" : "aos");
+    printf("  \"quantization_step\": %g,\n", options.quantize);
+    printf("  \"threads\": %zu,\n",
+           options.threads > 0 ? (size_t)options.threads
+                               : utility::ThreadPool::Global().NumThreads());
+    printf("  \"simd\": \"%s\",\n",
+           io::internal::SimdLevelName(io::internal::GetSimdLevel()));
+    printf("  \"results\": [\n");
+    bool ok = true;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        PrintResult(results[i], options.points, i + 1 == results.size());
+        ok = ok && results[i].ok;
+    }
+    printf("  ]\n");
+    printf("}\n");
+    return ok ? 0 : 1;
+}